@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../CachePolicy.h"
+#include "../RemovalListener.h"
 #include "ArcLruPart.h"
 #include "ArcLfuPart.h"
 #include <memory>
@@ -21,6 +22,8 @@ namespace mwm1cCache
 
         void put(Key key, Value value) override
         {
+            Value oldValue{};
+            bool replaced = notifier_.hasListeners() && (lruPart_->peek(key, oldValue) || lfuPart_->peek(key, oldValue));
             // decide whether to adjust the capacity of LRU/LFU
             checkGhostCaches(key);
             // check if LfuPart contains the key
@@ -32,22 +35,33 @@ namespace mwm1cCache
             {
                 lfuPart_->put(key, value);
             }
+            if (replaced)
+            {
+                notifier_.enqueue(key, oldValue, RemovalCause::Replaced);
+            }
+            notifyEvictions();
         }
 
         bool get(Key key, Value &value) override
         {
             checkGhostCaches(key);
             bool shouldTransform = false;
-            
+            bool hit = false;
+
             if (lruPart_->get(key, value, shouldTransform))
             {
                 if (shouldTransform)
                 {
                     lfuPart_->put(key, value);
                 }
-                return true;
+                hit = true;
+            }
+            else
+            {
+                hit = lfuPart_->get(key, value);
             }
-            return lfuPart_->get(key, value);
+            notifyEvictions();
+            return hit;
         }
 
         Value get(Key key) override
@@ -57,7 +71,89 @@ namespace mwm1cCache
             return value;
         }
 
+        // payload: uint64 capacity, uint64 transform threshold, the LRU part section, the LFU part section
+        bool saveSnapshot(const std::string &path)
+        {
+            SnapshotWriter writer(SnapshotPolicy::Arc);
+            if (!writer.open(path))
+            {
+                return false;
+            }
+            writer.write(static_cast<uint64_t>(capacity_));
+            writer.write(static_cast<uint64_t>(transformThreshold_));
+            lruPart_->writeSnapshot(writer);
+            lfuPart_->writeSnapshot(writer);
+            return writer.commit();
+        }
+
+        /**
+         * Restores T1/T2, both ghost lists and the adapted capacity split. Both parts are rebuilt from the
+         * mapped file into fresh objects and only swapped in if the whole snapshot decodes, so a failed load
+         * leaves the cache untouched. Meant to run before the cache serves traffic.
+         */
+        bool loadSnapshot(const std::string &path)
+        {
+            SnapshotReader reader;
+            uint64_t capacity = 0;
+            uint64_t transformThreshold = 0;
+            if (!reader.open(path, SnapshotPolicy::Arc) || !reader.read(capacity) || !reader.read(transformThreshold))
+            {
+                return false;
+            }
+            auto lruPart = std::make_unique<ArcLruPart<Key, Value>>(capacity, transformThreshold);
+            auto lfuPart = std::make_unique<ArcLfuPart<Key, Value>>(capacity, transformThreshold);
+            if (!lruPart->readSnapshot(reader) || !lfuPart->readSnapshot(reader) || !reader.atEnd())
+            {
+                return false;
+            }
+            if (notifier_.hasListeners())
+            {
+                lruPart->trackEvictions();
+                lfuPart->trackEvictions();
+            }
+            capacity_ = capacity;
+            transformThreshold_ = transformThreshold;
+            lruPart_.swap(lruPart);
+            lfuPart_.swap(lfuPart);
+            return true;
+        }
+
+        // listeners run after the part locks are released, never under them
+        void addRemovalListener(typename RemovalNotifier<Key, Value>::Listener listener)
+        {
+            lruPart_->trackEvictions();
+            lfuPart_->trackEvictions();
+            notifier_.addListener(std::move(listener));
+        }
+
     private:
+        /**
+         * An entry promoted to the LFU part keeps its copy in the LRU part, so a part evicting a key
+         * only removes it from the cache when the other part does not hold it too.
+         */
+        void notifyEvictions()
+        {
+            if (!notifier_.hasListeners())
+            {
+                return;
+            }
+            for (auto &entry : lruPart_->takeEvicted())
+            {
+                if (!lfuPart_->contain(entry.first))
+                {
+                    notifier_.enqueue(entry.first, entry.second, RemovalCause::Size);
+                }
+            }
+            for (auto &entry : lfuPart_->takeEvicted())
+            {
+                if (!lruPart_->contain(entry.first))
+                {
+                    notifier_.enqueue(entry.first, entry.second, RemovalCause::Size);
+                }
+            }
+            notifier_.dispatch();
+        }
+
         bool checkGhostCaches(Key key)
         {
             bool inGhost = false;
@@ -84,5 +180,6 @@ namespace mwm1cCache
         size_t transformThreshold_;
         std::unique_ptr<ArcLruPart<Key, Value>> lruPart_;
         std::unique_ptr<ArcLfuPart<Key, Value>> lfuPart_;
+        RemovalNotifier<Key, Value> notifier_;
     };
 }
\ No newline at end of file
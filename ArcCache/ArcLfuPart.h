@@ -1,9 +1,14 @@
 #pragma once
 
 #include "ArcCacheNode.h"
+#include "../CacheSnapshot.h"
+#include <algorithm>
 #include <unordered_map>
 #include <mutex>
 #include <map>
+#include <list>
+#include <utility>
+#include <vector>
 
 namespace mwm1cCache
 {
@@ -16,7 +21,8 @@ namespace mwm1cCache
         using NodeMap = std::unordered_map<Key, NodePtr>;
         using FreqMap = std::unordered_map<size_t, std::list<NodePtr>>;
         explicit ArcLfuPart(size_t capacity, size_t transformThreshold)
-            : capacity_(capacity), ghostCapacity_(capacity), transformThreshold_(transformThreshold), minFreq_(0)
+            : capacity_(capacity), ghostCapacity_(capacity), transformThreshold_(transformThreshold), minFreq_(0),
+              trackEvictions_(false)
         {
             initializeLists();
         }
@@ -51,9 +57,130 @@ namespace mwm1cCache
 
         bool contain(Key key)
         {
+            std::lock_guard<std::mutex> lock(mutex_);
             return mainCache_.find(key) != mainCache_.end();
         }
 
+        // evictions are only recorded once ArcCache has a removal listener
+        void trackEvictions()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            trackEvictions_ = true;
+        }
+
+        std::vector<std::pair<Key, Value>> takeEvicted()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<std::pair<Key, Value>> evicted;
+            evicted.swap(evicted_);
+            return evicted;
+        }
+
+        bool peek(Key key, Value &value)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = mainCache_.find(key);
+            if (it != mainCache_.end())
+            {
+                value = it->second->getValue();
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * section: uint64 capacity, uint64 ghost capacity, uint64 list count, then per frequency list in
+         * ascending order uint64 freq, uint64 size and size (key, value) pairs in eviction order, then
+         * uint64 ghost count and the ghost keys from oldest to newest
+         */
+        void writeSnapshot(SnapshotWriter &writer)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<size_t> freqs;
+            for (auto &pair : freqMap_)
+            {
+                freqs.push_back(pair.first);
+            }
+            std::sort(freqs.begin(), freqs.end());
+            writer.write(static_cast<uint64_t>(capacity_));
+            writer.write(static_cast<uint64_t>(ghostCapacity_));
+            writer.write(static_cast<uint64_t>(freqs.size()));
+            for (size_t freq : freqs)
+            {
+                auto &nodes = freqMap_[freq];
+                writer.write(static_cast<uint64_t>(freq));
+                writer.write(static_cast<uint64_t>(nodes.size()));
+                for (auto &node : nodes)
+                {
+                    writer.write(node->key_);
+                    writer.write(node->value_);
+                }
+            }
+            writer.write(static_cast<uint64_t>(ghostCache_.size()));
+            for (NodePtr node = ghostHead_->next_; node != ghostTail_; node = node->next_)
+            {
+                writer.write(node->key_);
+            }
+        }
+
+        // only meant for a freshly constructed part
+        bool readSnapshot(SnapshotReader &reader)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint64_t capacity = 0;
+            uint64_t ghostCapacity = 0;
+            uint64_t listCount = 0;
+            if (!reader.read(capacity) || !reader.read(ghostCapacity) || !reader.read(listCount))
+            {
+                return false;
+            }
+            capacity_ = capacity;
+            ghostCapacity_ = ghostCapacity;
+            for (uint64_t i = 0; i < listCount; ++i)
+            {
+                uint64_t freq = 0;
+                uint64_t size = 0;
+                if (!reader.read(freq) || !reader.read(size) || freq == 0)
+                {
+                    return false;
+                }
+                auto &nodes = freqMap_[freq];
+                for (uint64_t j = 0; j < size; ++j)
+                {
+                    Key key{};
+                    Value value{};
+                    if (!reader.read(key) || !reader.read(value))
+                    {
+                        return false;
+                    }
+                    NodePtr node = std::make_shared<NodeType>(key, value);
+                    node->accessCount_ = freq;
+                    nodes.push_back(node);
+                    mainCache_[key] = node;
+                }
+                if (i == 0 || freq < minFreq_)
+                {
+                    minFreq_ = freq;
+                }
+            }
+            uint64_t ghostCount = 0;
+            if (!reader.read(ghostCount))
+            {
+                return false;
+            }
+            ghostCache_.reserve(ghostCount);
+            for (uint64_t i = 0; i < ghostCount; ++i)
+            {
+                Key key{};
+                if (!reader.read(key))
+                {
+                    return false;
+                }
+                addToGhost(std::make_shared<NodeType>(key, Value()));
+            }
+            return true;
+        }
+
         bool checkGhost(Key key)
         {
             auto it = ghostCache_.find(key);
@@ -176,6 +303,10 @@ namespace mwm1cCache
 
             // remove from main cache
             mainCache_.erase(leastNode->getKey());
+            if (trackEvictions_)
+            {
+                evicted_.emplace_back(leastNode->getKey(), leastNode->getValue());
+            }
         }
 
         void removeFromGhost(NodePtr node)
@@ -216,7 +347,10 @@ namespace mwm1cCache
         size_t ghostCapacity_;
         size_t transformThreshold_;
         size_t minFreq_;
+        bool trackEvictions_;
         std::mutex mutex_;
+        // evicted since the last takeEvicted()
+        std::vector<std::pair<Key, Value>> evicted_;
 
         NodeMap mainCache_;
         NodeMap ghostCache_;
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "ArcCacheNode.h"
+#include "../CacheSnapshot.h"
 #include <unordered_map>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 namespace mwm1cCache
 {
@@ -15,7 +18,7 @@ namespace mwm1cCache
         using NodeMap = std::unordered_map<Key, NodePtr>;
 
         explicit ArcLruPart(size_t cap, size_t transformThreshold)
-            : capacity_(cap), ghostCapacity_(cap), transformThreshold_(transformThreshold)
+            : capacity_(cap), ghostCapacity_(cap), transformThreshold_(transformThreshold), trackEvictions_(false)
         {
             initializeLists();
         }
@@ -52,6 +55,114 @@ namespace mwm1cCache
             return false;
         }
 
+        bool contain(Key key)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return mainCache_.find(key) != mainCache_.end();
+        }
+
+        // evictions are only recorded once ArcCache has a removal listener
+        void trackEvictions()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            trackEvictions_ = true;
+        }
+
+        std::vector<std::pair<Key, Value>> takeEvicted()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<std::pair<Key, Value>> evicted;
+            evicted.swap(evicted_);
+            return evicted;
+        }
+
+        bool peek(Key key, Value &value)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = mainCache_.find(key);
+            if (it != mainCache_.end())
+            {
+                value = it->second->getValue();
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * section: uint64 capacity, uint64 ghost capacity, uint64 count, count (key, value, uint64 access count)
+         * from most to least recent, then uint64 ghost count and the ghost keys from most to least recent
+         */
+        void writeSnapshot(SnapshotWriter &writer)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writer.write(static_cast<uint64_t>(capacity_));
+            writer.write(static_cast<uint64_t>(ghostCapacity_));
+            writer.write(static_cast<uint64_t>(mainCache_.size()));
+            for (NodePtr node = mainHead_->next_; node != mainTail_; node = node->next_)
+            {
+                writer.write(node->key_);
+                writer.write(node->value_);
+                writer.write(static_cast<uint64_t>(node->accessCount_));
+            }
+            writer.write(static_cast<uint64_t>(ghostCache_.size()));
+            for (NodePtr node = ghostHead_->next_; node != ghostTail_; node = node->next_)
+            {
+                writer.write(node->key_);
+            }
+        }
+
+        // only meant for a freshly constructed part
+        bool readSnapshot(SnapshotReader &reader)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint64_t capacity = 0;
+            uint64_t ghostCapacity = 0;
+            uint64_t count = 0;
+            if (!reader.read(capacity) || !reader.read(ghostCapacity) || !reader.read(count))
+            {
+                return false;
+            }
+            capacity_ = capacity;
+            ghostCapacity_ = ghostCapacity;
+            mainCache_.reserve(count);
+            NodePtr last = mainHead_;
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                Key key{};
+                Value value{};
+                uint64_t accessCount = 0;
+                if (!reader.read(key) || !reader.read(value) || !reader.read(accessCount))
+                {
+                    return false;
+                }
+                NodePtr node = std::make_shared<NodeType>(key, value);
+                node->accessCount_ = accessCount;
+                appendAfter(last, node);
+                last = node;
+                mainCache_[key] = node;
+            }
+            uint64_t ghostCount = 0;
+            if (!reader.read(ghostCount))
+            {
+                return false;
+            }
+            ghostCache_.reserve(ghostCount);
+            last = ghostHead_;
+            for (uint64_t i = 0; i < ghostCount; ++i)
+            {
+                Key key{};
+                if (!reader.read(key))
+                {
+                    return false;
+                }
+                NodePtr node = std::make_shared<NodeType>(key, Value());
+                appendAfter(last, node);
+                last = node;
+                ghostCache_[key] = node;
+            }
+            return true;
+        }
+
         bool checkGhost(Key key)
         {
             auto it = ghostCache_.find(key);
@@ -160,6 +271,19 @@ namespace mwm1cCache
             }
             addToGhost(leastRecent);
             mainCache_.erase(leastRecent->getKey());
+            if (trackEvictions_)
+            {
+                evicted_.emplace_back(leastRecent->getKey(), leastRecent->getValue());
+            }
+        }
+
+        // links node right behind prev, used to rebuild a list in order
+        void appendAfter(NodePtr prev, NodePtr node)
+        {
+            node->next_ = prev->next_;
+            node->prev_ = prev;
+            prev->next_->prev_ = node;
+            prev->next_ = node;
         }
 
         void removeFromMain(NodePtr node)
@@ -211,7 +335,10 @@ namespace mwm1cCache
         size_t capacity_;
         size_t ghostCapacity_;
         size_t transformThreshold_;
+        bool trackEvictions_;
         std::mutex mutex_;
+        // evicted since the last takeEvicted()
+        std::vector<std::pair<Key, Value>> evicted_;
         // key -> ArcNode
         NodeMap mainCache_;
         NodeMap ghostCache_;
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace mwm1cCache
+{
+    /**
+     * Blocked counting bloom filter: every key maps to one 64-byte block (a cache line of 128 4-bit
+     * counters) and sets PROBES counters inside it, so a check touches a single line. Counters saturate
+     * at 15 and then stay there, which can only cost false positives, never false negatives.
+     *
+     * add/remove/clear must be serialized by the owner (the cache calls them under its lock);
+     * mayContain only does atomic loads and can run concurrently with them.
+     */
+    class CountingBloomFilter
+    {
+    public:
+        // countersPerKey trades memory (half a byte per counter) for the false positive rate
+        CountingBloomFilter(size_t expectedKeys, size_t countersPerKey)
+            : blockCount_(std::max<size_t>(1, (expectedKeys * countersPerKey + COUNTERS_PER_BLOCK - 1) / COUNTERS_PER_BLOCK)),
+              blocks_(new Block[blockCount_])
+        {
+            clear();
+        }
+
+        bool mayContain(uint64_t hash) const
+        {
+            const Block &block = blocks_[blockOf(hash)];
+            for (int probe = 0; probe < PROBES; ++probe)
+            {
+                size_t counter = counterOf(hash, probe);
+                uint64_t word = block.words[counter / 16].load(std::memory_order_acquire);
+                if (((word >> ((counter % 16) * 4)) & 0xf) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        void add(uint64_t hash)
+        {
+            update(hash, +1);
+        }
+        void remove(uint64_t hash)
+        {
+            update(hash, -1);
+        }
+        void clear()
+        {
+            for (size_t i = 0; i < blockCount_; ++i)
+            {
+                for (auto &word : blocks_[i].words)
+                {
+                    word.store(0, std::memory_order_release);
+                }
+            }
+        }
+        // std::hash is the identity for integers, spread the bits before using them as probes
+        static uint64_t mix(uint64_t hash)
+        {
+            hash += 0x9e3779b97f4a7c15ULL;
+            hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+            return hash ^ (hash >> 31);
+        }
+
+    private:
+        static constexpr int PROBES = 4;
+        static constexpr size_t COUNTERS_PER_BLOCK = 128;
+
+        struct alignas(64) Block
+        {
+            std::atomic<uint64_t> words[8];
+        };
+
+        size_t blockOf(uint64_t hash) const
+        {
+            return static_cast<size_t>((hash >> 32) % blockCount_);
+        }
+        // 7 bits per probe from the low half of the hash
+        static size_t counterOf(uint64_t hash, int probe)
+        {
+            return static_cast<size_t>((hash >> (probe * 7)) & (COUNTERS_PER_BLOCK - 1));
+        }
+        // writers are serialized, so a plain load + store per counter is enough
+        void update(uint64_t hash, int delta)
+        {
+            Block &block = blocks_[blockOf(hash)];
+            for (int probe = 0; probe < PROBES; ++probe)
+            {
+                size_t counter = counterOf(hash, probe);
+                std::atomic<uint64_t> &slot = block.words[counter / 16];
+                uint64_t word = slot.load(std::memory_order_relaxed);
+                int shift = static_cast<int>((counter % 16) * 4);
+                uint64_t count = (word >> shift) & 0xf;
+                if (count == 0xf || (delta < 0 && count == 0))
+                {
+                    continue;
+                }
+                count += delta;
+                word = (word & ~(uint64_t(0xf) << shift)) | (count << shift);
+                slot.store(word, std::memory_order_release);
+            }
+        }
+
+        size_t blockCount_;
+        std::unique_ptr<Block[]> blocks_;
+    };
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace mwm1cCache
+{
+    // where background work of a cache (async loads, flushes, refreshes) gets scheduled
+    class CacheExecutor
+    {
+    public:
+        virtual ~CacheExecutor() {};
+        virtual void execute(std::function<void()> task) = 0;
+    };
+
+    // runs the task on the calling thread, useful for tests and already-asynchronous callers
+    class InlineExecutor : public CacheExecutor
+    {
+    public:
+        void execute(std::function<void()> task) override
+        {
+            task();
+        }
+    };
+
+    class ThreadPoolExecutor : public CacheExecutor
+    {
+    public:
+        explicit ThreadPoolExecutor(size_t threadNum = std::thread::hardware_concurrency())
+            : stop_(false)
+        {
+            if (threadNum == 0)
+            {
+                threadNum = 1;
+            }
+            for (size_t i = 0; i < threadNum; ++i)
+            {
+                workers_.emplace_back([this]() { workerLoop(); });
+            }
+        }
+        ~ThreadPoolExecutor() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_all();
+            for (auto &worker : workers_)
+            {
+                worker.join();
+            }
+        }
+        void execute(std::function<void()> task) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                tasks_.push(std::move(task));
+            }
+            cond_.notify_one();
+        }
+
+    private:
+        void workerLoop()
+        {
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cond_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                    // drain the queue before stopping so no accepted task is dropped
+                    if (tasks_.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(tasks_.front());
+                    tasks_.pop();
+                }
+                task();
+            }
+        }
+
+        bool stop_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::queue<std::function<void()>> tasks_;
+        std::vector<std::thread> workers_;
+    };
+}
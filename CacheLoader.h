@@ -0,0 +1,210 @@
+#pragma once
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include "CacheExecutor.h"
+#include "CachePolicy.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Coalesces concurrent loads of the same key. The first caller becomes the leader and runs
+     * the load, every caller arriving while it is in flight waits on the leader's shared future
+     * instead of hitting the backend again.
+     */
+    template <typename Key, typename Value>
+    class SingleFlight
+    {
+    public:
+        template <typename LoadFunc>
+        Value load(const Key &key, LoadFunc loadFunc)
+        {
+            std::promise<Value> promise;
+            std::shared_future<Value> future;
+            bool isLeader = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = inFlight_.find(key);
+                if (it != inFlight_.end())
+                {
+                    future = it->second;
+                }
+                else
+                {
+                    future = promise.get_future().share();
+                    inFlight_.emplace(key, future);
+                    isLeader = true;
+                }
+            }
+            if (!isLeader)
+            {
+                return future.get();
+            }
+            // the load runs without holding any lock, waiters only block on the future
+            try
+            {
+                promise.set_value(loadFunc());
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                inFlight_.erase(key);
+            }
+            return future.get();
+        }
+
+        /**
+         * Same coalescing as load(), but the leader's load is scheduled on the executor and every
+         * caller gets the shared future back immediately. The owner must outlive pending loads.
+         */
+        template <typename LoadFunc>
+        std::shared_future<Value> loadAsync(const Key &key, CacheExecutor &executor, LoadFunc loadFunc)
+        {
+            auto promise = std::make_shared<std::promise<Value>>();
+            std::shared_future<Value> future;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = inFlight_.find(key);
+                if (it != inFlight_.end())
+                {
+                    return it->second;
+                }
+                future = promise->get_future().share();
+                inFlight_.emplace(key, future);
+            }
+            executor.execute([this, key, promise, loadFunc]() {
+                try
+                {
+                    promise->set_value(loadFunc());
+                }
+                catch (...)
+                {
+                    promise->set_exception(std::current_exception());
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                inFlight_.erase(key);
+            });
+            return future;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<Key, std::shared_future<Value>> inFlight_;
+    };
+
+    // whether Cache has putLoaded(key, value), a fill that write-behind does not write back
+    template <typename Cache, typename Key, typename Value, typename = void>
+    struct HasPutLoaded : std::false_type
+    {
+    };
+    template <typename Cache, typename Key, typename Value>
+    struct HasPutLoaded<Cache, Key, Value,
+                        std::void_t<decltype(std::declval<Cache &>().putLoaded(std::declval<Key>(), std::declval<Value>()))>>
+        : std::true_type
+    {
+    };
+
+    // whether Cache has peek(key, value), a lookup without recency, frequency or history updates
+    template <typename Cache, typename Key, typename Value, typename = void>
+    struct HasPeek : std::false_type
+    {
+    };
+    template <typename Cache, typename Key, typename Value>
+    struct HasPeek<Cache, Key, Value,
+                   std::void_t<decltype(std::declval<Cache &>().peek(std::declval<const Key &>(), std::declval<Value &>()))>>
+        : std::true_type
+    {
+    };
+
+    /**
+     * Read-through decorator: getOrLoad()/getAsync() on top of any cache with get(key, value) and
+     * put(key, value), CachePolicy by default. Each request is one get, and a miss is filled with one
+     * putLoaded (put where Cache has none), so a policy's admission logic (e.g. LRU-K history) counts a
+     * read-through miss once. Pass the concrete cache type to get the side-effect free peek() re-check.
+     * Concurrent misses on the same key share a single load, and the loader runs outside the cache
+     * lock. The cache must outlive the decorator, and the decorator its pending async loads.
+     */
+    template <typename Key, typename Value, typename Cache = CachePolicy<Key, Value>>
+    class LoadingCache
+    {
+    public:
+        explicit LoadingCache(Cache &cache)
+            : cache_(cache)
+        {
+        }
+
+        // on a miss the loader is called as loader(key) and its result is cached
+        template <typename Loader>
+        Value getOrLoad(Key key, Loader loader)
+        {
+            Value value{};
+            if (cache_.get(key, value))
+            {
+                return value;
+            }
+            return loads_.load(key, [this, key, loader]() { return loadThrough(key, loader); });
+        }
+        /**
+         * Non-blocking variant of getOrLoad: a hit returns a ready future, a miss schedules the loader
+         * on the executor. Misses on a key already loading (sync or async) share the in-flight load.
+         */
+        template <typename Loader>
+        std::shared_future<Value> getAsync(Key key, Loader loader, CacheExecutor &executor)
+        {
+            Value value{};
+            if (cache_.get(key, value))
+            {
+                std::promise<Value> ready;
+                ready.set_value(value);
+                return ready.get_future().share();
+            }
+            return loads_.loadAsync(key, executor, [this, key, loader]() { return loadThrough(key, loader); });
+        }
+        Cache &cache()
+        {
+            return cache_;
+        }
+
+    private:
+        template <typename Loader>
+        Value loadThrough(const Key &key, const Loader &loader)
+        {
+            // the previous leader may have filled the entry after our miss; the miss itself was
+            // already counted, so look without touching recency or admission history
+            Value loaded{};
+            if constexpr (HasPeek<Cache, Key, Value>::value)
+            {
+                if (cache_.peek(key, loaded))
+                {
+                    return loaded;
+                }
+            }
+            else if (cache_.get(key, loaded))
+            {
+                return loaded;
+            }
+            loaded = loader(key);
+            // the value came from the backend, it must not be marked dirty
+            if constexpr (HasPutLoaded<Cache, Key, Value>::value)
+            {
+                cache_.putLoaded(key, loaded);
+            }
+            else
+            {
+                cache_.put(key, loaded);
+            }
+            return loaded;
+        }
+
+        Cache &cache_;
+        SingleFlight<Key, Value> loads_;
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace mwm1cCache
+{
+    /**
+     * Lock types for the Mutex parameter of LruCache/HashLruCaches and the Locking policy of Cache:
+     * std::mutex (default), NullMutex, SpinMutex, or std::shared_mutex, with which peek() and scans
+     * take the lock shared.
+     */
+
+    // for thread-confined caches and caches that are only touched under some outer lock
+    class NullMutex
+    {
+    public:
+        void lock() {}
+        bool try_lock() { return true; }
+        void unlock() {}
+        void lock_shared() {}
+        void unlock_shared() {}
+    };
+
+    /**
+     * Test-and-test-and-set spinlock: waiters spin on a plain load, so the line stays shared until the
+     * lock is released, and back off exponentially up to MAX_SPINS pause instructions before they start
+     * yielding the CPU. Only for critical sections of a few hundred nanoseconds.
+     */
+    class SpinMutex
+    {
+    public:
+        void lock()
+        {
+            int spins = 1;
+            while (locked_.exchange(true, std::memory_order_acquire))
+            {
+                while (locked_.load(std::memory_order_relaxed))
+                {
+                    if (spins <= MAX_SPINS)
+                    {
+                        for (int i = 0; i < spins; ++i)
+                        {
+                            pause();
+                        }
+                        spins <<= 1;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+        bool try_lock()
+        {
+            return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+        }
+        void unlock()
+        {
+            locked_.store(false, std::memory_order_release);
+        }
+
+    private:
+        static constexpr int MAX_SPINS = 64;
+
+        static void pause()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+
+        std::atomic<bool> locked_{false};
+    };
+
+    template <typename Mutex, typename = void>
+    struct HasSharedLock : std::false_type
+    {
+    };
+    template <typename Mutex>
+    struct HasSharedLock<Mutex, std::void_t<decltype(std::declval<Mutex &>().lock_shared())>> : std::true_type
+    {
+    };
+
+    // guard for read-only sections: shared where the mutex supports it, exclusive otherwise
+    template <typename Mutex>
+    using ReadLock = std::conditional_t<HasSharedLock<Mutex>::value, std::shared_lock<Mutex>, std::unique_lock<Mutex>>;
+}
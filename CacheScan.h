@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CacheLock.h"
+
+namespace mwm1cCache
+{
+    // buckets copied per lock hold
+    constexpr size_t SCAN_CHUNK_BUCKETS = 256;
+
+    /**
+     * Weakly consistent walk over one slice's hash table: the entries of SCAN_CHUNK_BUCKETS buckets are
+     * copied under the lock and handed to visitor(key, value) after it is released, so the visitor may
+     * be slow or call back into the cache. An entry cached for the whole walk is visited exactly once
+     * unless the table rehashes meanwhile (it only grows until the slice is full); entries put or removed
+     * during the walk may or may not be seen. extract(node, value) copies out the value stored in a map
+     * node, or returns false to skip it (e.g. expired).
+     * Returns the number of entries visited. The lock is taken shared where the mutex supports it.
+     */
+    template <typename Key, typename Value, typename Mutex, typename Map, typename Extract, typename Visitor>
+    size_t scanChunked(Mutex &mutex, const Map &map, Extract extract, Visitor &visitor)
+    {
+        size_t visited = 0;
+        size_t bucket = 0;
+        size_t bucketCount = 0;
+        std::vector<std::pair<Key, Value>> chunk;
+        while (true)
+        {
+            {
+                ReadLock<Mutex> lock(mutex);
+                // after a rehash the bucket index means something else, carry on from the same position
+                bucketCount = map.bucket_count();
+                size_t end = std::min(bucketCount, bucket + SCAN_CHUNK_BUCKETS);
+                for (; bucket < end; ++bucket)
+                {
+                    for (auto it = map.begin(bucket); it != map.end(bucket); ++it)
+                    {
+                        Value value{};
+                        if (extract(it->second, value))
+                        {
+                            chunk.emplace_back(it->first, std::move(value));
+                        }
+                    }
+                }
+            }
+            for (const auto &entry : chunk)
+            {
+                visitor(entry.first, entry.second);
+            }
+            visited += chunk.size();
+            chunk.clear();
+            if (bucket >= bucketCount)
+            {
+                return visited;
+            }
+        }
+    }
+
+    // forEach() over every slice on up to threads threads, the visitor must be thread-safe
+    template <typename Cache, typename Visitor>
+    size_t scanSlices(const std::vector<std::unique_ptr<Cache>> &slices, int threads, Visitor visitor)
+    {
+        std::atomic<size_t> nextSlice(0);
+        std::atomic<size_t> visited(0);
+        auto worker = [&]() {
+            for (size_t i = nextSlice++; i < slices.size(); i = nextSlice++)
+            {
+                visited += slices[i]->forEach(std::ref(visitor));
+            }
+        };
+        size_t workers = std::min(slices.size(), static_cast<size_t>(std::max(threads, 1)));
+        std::vector<std::thread> pool;
+        for (size_t i = 1; i < workers; ++i)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : pool)
+        {
+            thread.join();
+        }
+        return visited;
+    }
+}
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace mwm1cCache
+{
+    /**
+     * Snapshot file layout (little endian, as written by the host):
+     *   uint32 magic | uint16 version | uint8 policy | uint8 reserved | uint64 payload size | payload
+     * The payload is policy specific, see saveSnapshot()/loadSnapshot() of each cache.
+     */
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x434d574d; // "MWMC"
+    constexpr uint16_t SNAPSHOT_VERSION = 1;
+    constexpr size_t SNAPSHOT_HEADER_SIZE = 16;
+
+    enum class SnapshotPolicy : uint8_t
+    {
+        Lru = 1,
+        Lfu = 2,
+        Arc = 3
+    };
+
+    /**
+     * Encodes keys and values into a snapshot. Trivially copyable types are stored as raw bytes and
+     * std::string as length + bytes; specialize this template for any other Key/Value type.
+     */
+    template <typename T, typename Enable = void>
+    struct SnapshotSerializer;
+
+    template <typename T>
+    struct SnapshotSerializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type>
+    {
+        static void write(std::string &out, const T &value)
+        {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+        static bool read(const char *&cursor, const char *end, T &value)
+        {
+            if (static_cast<size_t>(end - cursor) < sizeof(T))
+            {
+                return false;
+            }
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return true;
+        }
+    };
+
+    template <>
+    struct SnapshotSerializer<std::string>
+    {
+        static void write(std::string &out, const std::string &value)
+        {
+            uint32_t size = static_cast<uint32_t>(value.size());
+            SnapshotSerializer<uint32_t>::write(out, size);
+            out.append(value);
+        }
+        static bool read(const char *&cursor, const char *end, std::string &value)
+        {
+            uint32_t size = 0;
+            if (!SnapshotSerializer<uint32_t>::read(cursor, end, size) || static_cast<size_t>(end - cursor) < size)
+            {
+                return false;
+            }
+            value.assign(cursor, size);
+            cursor += size;
+            return true;
+        }
+    };
+
+    /**
+     * Streams a snapshot into "<path>.tmp" through a bounded buffer and renames it over path on commit(),
+     * so a crash mid-write never leaves a torn snapshot behind.
+     */
+    class SnapshotWriter
+    {
+    public:
+        explicit SnapshotWriter(SnapshotPolicy policy)
+            : policy_(policy), file_(nullptr), payloadSize_(0), failed_(false)
+        {
+        }
+        ~SnapshotWriter()
+        {
+            if (file_)
+            {
+                std::fclose(file_);
+                std::remove(tmpPath_.c_str());
+            }
+        }
+        SnapshotWriter(const SnapshotWriter &) = delete;
+        SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+        bool open(const std::string &path)
+        {
+            path_ = path;
+            tmpPath_ = path + ".tmp";
+            file_ = std::fopen(tmpPath_.c_str(), "wb");
+            if (!file_)
+            {
+                return false;
+            }
+            // the payload size is patched in by commit()
+            writeHeader(0);
+            return true;
+        }
+        template <typename T>
+        void write(const T &value)
+        {
+            size_t before = buffer_.size();
+            SnapshotSerializer<T>::write(buffer_, value);
+            payloadSize_ += buffer_.size() - before;
+            if (buffer_.size() >= FLUSH_THRESHOLD)
+            {
+                flushBuffer();
+            }
+        }
+        bool commit()
+        {
+            flushBuffer();
+            if (failed_ || std::fseek(file_, 0, SEEK_SET) != 0)
+            {
+                return false;
+            }
+            writeHeader(payloadSize_);
+            flushBuffer();
+            bool ok = !failed_ && std::fflush(file_) == 0 && ::fsync(::fileno(file_)) == 0;
+            ok = (std::fclose(file_) == 0) && ok;
+            file_ = nullptr;
+            if (!ok || std::rename(tmpPath_.c_str(), path_.c_str()) != 0)
+            {
+                std::remove(tmpPath_.c_str());
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr size_t FLUSH_THRESHOLD = 1 << 20;
+
+        void writeHeader(uint64_t payloadSize)
+        {
+            SnapshotSerializer<uint32_t>::write(buffer_, SNAPSHOT_MAGIC);
+            SnapshotSerializer<uint16_t>::write(buffer_, SNAPSHOT_VERSION);
+            SnapshotSerializer<uint8_t>::write(buffer_, static_cast<uint8_t>(policy_));
+            SnapshotSerializer<uint8_t>::write(buffer_, 0);
+            SnapshotSerializer<uint64_t>::write(buffer_, payloadSize);
+        }
+        void flushBuffer()
+        {
+            if (!buffer_.empty() && std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size())
+            {
+                failed_ = true;
+            }
+            buffer_.clear();
+        }
+
+        SnapshotPolicy policy_;
+        std::FILE *file_;
+        std::string path_;
+        std::string tmpPath_;
+        std::string buffer_;
+        uint64_t payloadSize_;
+        bool failed_;
+    };
+
+    /**
+     * Maps a snapshot read-only and decodes it in place, the caches build their structures straight
+     * from the mapping instead of replaying puts.
+     */
+    class SnapshotReader
+    {
+    public:
+        SnapshotReader()
+            : data_(nullptr), size_(0), cursor_(nullptr), end_(nullptr)
+        {
+        }
+        ~SnapshotReader()
+        {
+            if (data_)
+            {
+                ::munmap(data_, size_);
+            }
+        }
+        SnapshotReader(const SnapshotReader &) = delete;
+        SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+        // maps a file without a snapshot header, e.g. an operation log segment
+        bool map(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            size_ = static_cast<size_t>(st.st_size);
+            if (size_ == 0)
+            {
+                ::close(fd);
+                return true;
+            }
+            void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+            {
+                size_ = 0;
+                return false;
+            }
+            data_ = data;
+            ::madvise(data_, size_, MADV_SEQUENTIAL);
+            cursor_ = static_cast<const char *>(data_);
+            end_ = cursor_ + size_;
+            return true;
+        }
+        // fails on a missing file, a foreign or newer format, another policy or a truncated payload
+        bool open(const std::string &path, SnapshotPolicy policy)
+        {
+            if (!map(path) || size_ < SNAPSHOT_HEADER_SIZE)
+            {
+                return false;
+            }
+            uint32_t magic = 0;
+            uint16_t version = 0;
+            uint8_t filePolicy = 0;
+            uint8_t reserved = 0;
+            uint64_t payloadSize = 0;
+            read(magic);
+            read(version);
+            read(filePolicy);
+            read(reserved);
+            read(payloadSize);
+            return magic == SNAPSHOT_MAGIC && version == SNAPSHOT_VERSION &&
+                   filePolicy == static_cast<uint8_t>(policy) && payloadSize == size_ - SNAPSHOT_HEADER_SIZE;
+        }
+        template <typename T>
+        bool read(T &value)
+        {
+            return SnapshotSerializer<T>::read(cursor_, end_, value);
+        }
+        bool atEnd() const
+        {
+            return cursor_ == end_;
+        }
+        size_t remaining() const
+        {
+            return static_cast<size_t>(end_ - cursor_);
+        }
+
+    private:
+        void *data_;
+        size_t size_;
+        const char *cursor_;
+        const char *end_;
+    };
+
+    /**
+     * Dumps the slices of a sharded cache without stopping it, the same way Redis BGSAVE does: every slice
+     * lock is held only for the fork() itself, then the child writes its copy-on-write image of the slices
+     * while the parent keeps serving. Pages written by the parent during the dump get copied, so peak
+     * memory grows with the write rate, not with the cache size.
+     */
+    class BackgroundSnapshot
+    {
+    public:
+        BackgroundSnapshot()
+            : pid_(0), status_(0)
+        {
+        }
+        ~BackgroundSnapshot()
+        {
+            wait();
+        }
+        BackgroundSnapshot(const BackgroundSnapshot &) = delete;
+        BackgroundSnapshot &operator=(const BackgroundSnapshot &) = delete;
+
+        static std::string slicePath(const std::string &path, size_t sliceIndex)
+        {
+            return path + "." + std::to_string(sliceIndex);
+        }
+        // false if a dump is already running or fork() failed
+        template <typename Cache>
+        bool start(const std::vector<std::unique_ptr<Cache>> &slices, const std::string &path)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pid_ > 0)
+            {
+                return false;
+            }
+            // quiesce every slice for the fork only, so the child never sees a half-applied operation
+            using SliceMutex = typename std::remove_reference<decltype(slices.front()->mutex_)>::type;
+            std::vector<std::unique_lock<SliceMutex>> sliceLocks;
+            for (auto &slice : slices)
+            {
+                sliceLocks.emplace_back(slice->mutex_);
+            }
+            pid_t pid = ::fork();
+            if (pid == 0)
+            {
+                // the child is single threaded and owns its copy, so it writes without taking the locks
+                bool ok = true;
+                for (size_t i = 0; i < slices.size(); ++i)
+                {
+                    ok = slices[i]->writeSnapshot(slicePath(path, i)) && ok;
+                }
+                ::_exit(ok ? 0 : 1);
+            }
+            sliceLocks.clear();
+            if (pid < 0)
+            {
+                return false;
+            }
+            pid_ = pid;
+            return true;
+        }
+        bool running()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return pid_ > 0 && ::waitpid(pid_, &status_, WNOHANG) == 0;
+        }
+        // blocks until the running dump finished, true if every slice file was written
+        bool wait()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pid_ <= 0)
+            {
+                return false;
+            }
+            pid_t pid = pid_;
+            pid_ = 0;
+            int status = 0;
+            if (::waitpid(pid, &status, 0) != pid)
+            {
+                // already reaped by running()
+                status = status_;
+            }
+            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+    private:
+        std::mutex mutex_;
+        pid_t pid_;
+        int status_;
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "CachePolicy.h"
+#include "ConcurrentHashIndex.h"
+
+namespace mwm1cCache
+{
+    /**
+     * CLOCK cache over ConcurrentHashIndex for read-mostly workloads. A hit takes no lock at all: the
+     * lookup is lock-free and recency is one referenced bit set in the entry. Updates of present keys lock
+     * one index stripe. Only inserting a new key takes the clock lock, which owns the ring of cached keys
+     * and sweeps it for an unreferenced victim, clearing referenced bits on the way.
+     */
+    template <typename Key, typename Value>
+    class ConcurrentClockCache : public CachePolicy<Key, Value>
+    {
+    public:
+        explicit ConcurrentClockCache(int cap)
+            : capacity_(cap > 0 ? static_cast<size_t>(cap) : 0), index_(capacity_), hand_(0)
+        {
+            ring_.reserve(capacity_);
+        }
+        ~ConcurrentClockCache() override = default;
+
+        void put(Key key, Value value) override
+        {
+            if (capacity_ == 0 || index_.update(key, value))
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(clockMutex_);
+            // new keys are only inserted under this lock, so absent now means absent until we insert
+            if (index_.update(key, value))
+            {
+                return;
+            }
+            if (ring_.size() < capacity_)
+            {
+                ring_.push_back(key);
+            }
+            else
+            {
+                ring_[evictOne()] = key;
+            }
+            index_.insert(key, value);
+        }
+        bool get(Key key, Value &value) override
+        {
+            return index_.get(key, value, REFERENCED);
+        }
+        Value get(Key key) override
+        {
+            Value value{};
+            get(key, value);
+            return value;
+        }
+
+    private:
+        static constexpr uint8_t REFERENCED = 1;
+
+        // caller holds clockMutex_; returns the ring slot freed
+        size_t evictOne()
+        {
+            while (true)
+            {
+                size_t slot = hand_;
+                hand_ = (hand_ + 1) % ring_.size();
+                // second chance: a referenced key loses its bit and stays for another round
+                if (index_.exchangeBits(ring_[slot], 0) != REFERENCED)
+                {
+                    index_.erase(ring_[slot]);
+                    return slot;
+                }
+            }
+        }
+
+        size_t capacity_;
+        ConcurrentHashIndex<Key, Value> index_;
+        std::mutex clockMutex_;
+        std::vector<Key> ring_;
+        size_t hand_;
+    };
+}
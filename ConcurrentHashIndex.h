@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EpochReclaimer.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Hash index with lock-free lookups: a fixed power-of-two array of bucket chains of atomic links.
+     * Writers serialize per lock stripe, not per table, and never modify a published node: an update
+     * links a copy in its place, so a reader standing on the old node still sees a complete (old) entry
+     * and the chain behind it. Unlinked nodes go to the EpochReclaimer and are freed once no reader can
+     * hold them, so readers pay one epoch pin per lookup instead of a reference count per hop.
+     *
+     * Each node carries a byte of policy bits (e.g. a CLOCK referenced bit) that readers set with a
+     * relaxed atomic or, so recency tracking does not need the writers' lock either. The bucket count is
+     * fixed at construction; size it for the expected number of keys.
+     */
+    template <typename Key, typename Value>
+    class ConcurrentHashIndex
+    {
+    public:
+        explicit ConcurrentHashIndex(size_t expectedKeys)
+        {
+            bucketCount_ = 1;
+            while (bucketCount_ < expectedKeys)
+            {
+                bucketCount_ <<= 1;
+            }
+            buckets_.reset(new std::atomic<Node *>[bucketCount_]);
+            for (size_t i = 0; i < bucketCount_; ++i)
+            {
+                buckets_[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        // no reader may be left; nodes retired earlier are still freed by the reclaimer
+        ~ConcurrentHashIndex()
+        {
+            for (size_t i = 0; i < bucketCount_; ++i)
+            {
+                Node *node = buckets_[i].load(std::memory_order_relaxed);
+                while (node)
+                {
+                    Node *next = node->next.load(std::memory_order_relaxed);
+                    delete node;
+                    node = next;
+                }
+            }
+        }
+
+        // lock-free; ors setBits into the entry's policy bits on a hit
+        bool get(const Key &key, Value &value, uint8_t setBits = 0) const
+        {
+            size_t hash = hashOf(key);
+            EpochGuard guard;
+            for (Node *node = buckets_[hash & (bucketCount_ - 1)].load(std::memory_order_acquire); node;
+                 node = node->next.load(std::memory_order_acquire))
+            {
+                if (node->hash == hash && node->key == key)
+                {
+                    if (setBits && (node->bits.load(std::memory_order_relaxed) & setBits) != setBits)
+                    {
+                        node->bits.fetch_or(setBits, std::memory_order_relaxed);
+                    }
+                    value = node->value;
+                    return true;
+                }
+            }
+            return false;
+        }
+        // replaces the policy bits of key and returns the old ones, -1 if the key is absent
+        int exchangeBits(const Key &key, uint8_t bits)
+        {
+            size_t hash = hashOf(key);
+            EpochGuard guard;
+            for (Node *node = buckets_[hash & (bucketCount_ - 1)].load(std::memory_order_acquire); node;
+                 node = node->next.load(std::memory_order_acquire))
+            {
+                if (node->hash == hash && node->key == key)
+                {
+                    return node->bits.exchange(bits, std::memory_order_relaxed);
+                }
+            }
+            return -1;
+        }
+        // replaces the value of a present key, keeping its policy bits; false if the key is absent
+        bool update(const Key &key, const Value &value)
+        {
+            size_t hash = hashOf(key);
+            std::lock_guard<std::mutex> lock(stripeOf(hash));
+            std::atomic<Node *> *link = &buckets_[hash & (bucketCount_ - 1)];
+            for (Node *node = link->load(std::memory_order_relaxed); node; link = &node->next, node = link->load(std::memory_order_relaxed))
+            {
+                if (node->hash == hash && node->key == key)
+                {
+                    Node *copy = new Node(key, value, hash, node->bits.load(std::memory_order_relaxed));
+                    copy->next.store(node->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    link->store(copy, std::memory_order_release);
+                    EpochReclaimer::shared().retire(node);
+                    return true;
+                }
+            }
+            return false;
+        }
+        // the caller guarantees that key is absent
+        void insert(const Key &key, const Value &value, uint8_t bits = 0)
+        {
+            size_t hash = hashOf(key);
+            std::lock_guard<std::mutex> lock(stripeOf(hash));
+            std::atomic<Node *> &head = buckets_[hash & (bucketCount_ - 1)];
+            Node *node = new Node(key, value, hash, bits);
+            node->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            head.store(node, std::memory_order_release);
+        }
+        bool erase(const Key &key)
+        {
+            size_t hash = hashOf(key);
+            std::lock_guard<std::mutex> lock(stripeOf(hash));
+            std::atomic<Node *> *link = &buckets_[hash & (bucketCount_ - 1)];
+            for (Node *node = link->load(std::memory_order_relaxed); node; link = &node->next, node = link->load(std::memory_order_relaxed))
+            {
+                if (node->hash == hash && node->key == key)
+                {
+                    // the unlinked node keeps its next, a reader standing on it can still walk on
+                    link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+                    EpochReclaimer::shared().retire(node);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        static constexpr size_t STRIPES = 64;
+
+        struct Node
+        {
+            Node(const Key &key, const Value &value, size_t hash, uint8_t bits)
+                : key(key), value(value), hash(hash), bits(bits)
+            {
+            }
+            const Key key;
+            const Value value;
+            const size_t hash;
+            std::atomic<uint8_t> bits;
+            std::atomic<Node *> next{nullptr};
+        };
+
+        // std::hash is the identity for integers, spread it before taking the low bits
+        static size_t hashOf(const Key &key)
+        {
+            uint64_t hash = std::hash<Key>()(key);
+            hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdULL;
+            hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+            return static_cast<size_t>(hash ^ (hash >> 33));
+        }
+        // a bucket always maps to the same stripe, so all writers of one chain share a lock
+        std::mutex &stripeOf(size_t hash)
+        {
+            return stripes_[(hash & (bucketCount_ - 1)) % STRIPES];
+        }
+
+        size_t bucketCount_;
+        std::unique_ptr<std::atomic<Node *>[]> buckets_;
+        std::mutex stripes_[STRIPES];
+    };
+}
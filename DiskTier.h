@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "CacheSnapshot.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Log-structured second tier on local disk. Values are appended to fixed size segment files
+     * "<path>.<segment>.seg" and found through an in-memory index; nothing is ever rewritten in place.
+     * Space is reclaimed a whole segment at a time: a segment whose entries were all removed or promoted
+     * is deleted right away, and when the tier is over capacity the oldest segment is dropped with
+     * whatever it still holds (FIFO, the same order its entries were demoted in).
+     *
+     * record: uint32 length of the rest | key | value
+     *
+     * The files are scratch space, they are truncated on construction and deleted on destruction.
+     */
+    template <typename Key, typename Value>
+    class DiskTier
+    {
+    public:
+        // decides per demoted entry whether it is worth a disk write, empty admits everything
+        using Admission = std::function<bool(const Key &, const Value &)>;
+
+        DiskTier(std::string path, size_t capacityBytes, size_t segmentBytes, Admission admission = nullptr)
+            : path_(std::move(path)), capacityBytes_(capacityBytes), segmentBytes_(segmentBytes),
+              admission_(std::move(admission)), nextSegment_(0), totalBytes_(0)
+        {
+        }
+        ~DiskTier()
+        {
+            for (auto &pair : segments_)
+            {
+                std::remove(pair.second->path.c_str());
+            }
+        }
+        DiskTier(const DiskTier &) = delete;
+        DiskTier &operator=(const DiskTier &) = delete;
+
+        // false if the entry was not admitted or does not fit into a segment
+        bool put(const Key &key, const Value &value)
+        {
+            if (admission_ && !admission_(key, value))
+            {
+                return false;
+            }
+            std::string record;
+            SnapshotSerializer<uint32_t>::write(record, 0);
+            SnapshotSerializer<Key>::write(record, key);
+            SnapshotSerializer<Value>::write(record, value);
+            uint32_t length = static_cast<uint32_t>(record.size() - sizeof(uint32_t));
+            std::memcpy(&record[0], &length, sizeof(length));
+            if (record.size() > segmentBytes_)
+            {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!active_ || active_->size + record.size() > segmentBytes_)
+            {
+                if (!openSegment())
+                {
+                    return false;
+                }
+            }
+            // an append only touches the page cache, so it stays under the lock to keep the index exact
+            if (::pwrite(active_->fd, record.data(), record.size(), active_->size) != static_cast<ssize_t>(record.size()))
+            {
+                return false;
+            }
+            Location location{active_->id, active_->size, static_cast<uint32_t>(record.size())};
+            active_->size += record.size();
+            active_->liveBytes += record.size();
+            active_->keys.push_back(key);
+            totalBytes_ += record.size();
+            auto it = index_.find(key);
+            if (it != index_.end())
+            {
+                // repoint first, unlinking may drop the old segment and everything still indexed into it
+                Location stale = it->second;
+                it->second = location;
+                unlinkLocation(stale);
+            }
+            else
+            {
+                index_.emplace(key, location);
+            }
+            while (totalBytes_ > capacityBytes_ && segments_.size() > 1)
+            {
+                dropSegment(segments_.begin()->second);
+            }
+            return true;
+        }
+        bool get(const Key &key, Value &value)
+        {
+            return lookup(key, value, false);
+        }
+        // get and remove in one step, used when an entry is promoted back into memory
+        bool take(const Key &key, Value &value)
+        {
+            return lookup(key, value, true);
+        }
+        void remove(const Key &key)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end())
+            {
+                Location location = it->second;
+                index_.erase(it);
+                unlinkLocation(location);
+            }
+        }
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return index_.size();
+        }
+        // bytes held by segment files, live or not
+        size_t diskBytes()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return totalBytes_;
+        }
+
+    private:
+        struct Segment
+        {
+            uint64_t id;
+            int fd;
+            std::string path;
+            size_t size;
+            size_t liveBytes;
+            // every key appended, stale ones are skipped when the segment is dropped
+            std::vector<Key> keys;
+
+            Segment(uint64_t id, int fd, std::string path)
+                : id(id), fd(fd), path(std::move(path)), size(0), liveBytes(0) {}
+            // the file is unlinked when dropped, readers still holding the segment keep a valid fd
+            ~Segment()
+            {
+                ::close(fd);
+            }
+        };
+        using SegmentPtr = std::shared_ptr<Segment>;
+
+        struct Location
+        {
+            uint64_t segment;
+            size_t offset;
+            uint32_t length;
+        };
+
+        bool lookup(const Key &key, Value &value, bool erase)
+        {
+            SegmentPtr segment;
+            Location location;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = index_.find(key);
+                if (it == index_.end())
+                {
+                    return false;
+                }
+                location = it->second;
+                segment = segments_[location.segment];
+                if (erase)
+                {
+                    index_.erase(it);
+                    unlinkLocation(location);
+                }
+            }
+            // the read runs outside the lock; records are immutable, so a concurrent drop cannot tear it
+            std::string record(location.length, '\0');
+            if (::pread(segment->fd, &record[0], record.size(), location.offset) != static_cast<ssize_t>(record.size()))
+            {
+                return false;
+            }
+            const char *cursor = record.data() + sizeof(uint32_t);
+            const char *end = record.data() + record.size();
+            Key storedKey{};
+            return SnapshotSerializer<Key>::read(cursor, end, storedKey) &&
+                   SnapshotSerializer<Value>::read(cursor, end, value);
+        }
+        bool openSegment()
+        {
+            uint64_t id = nextSegment_++;
+            std::string path = path_ + "." + std::to_string(id) + ".seg";
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+            {
+                return false;
+            }
+            active_ = std::make_shared<Segment>(id, fd, path);
+            segments_.emplace(id, active_);
+            return true;
+        }
+        // caller holds mutex_ and has already erased the index entry
+        void unlinkLocation(const Location &location)
+        {
+            auto it = segments_.find(location.segment);
+            if (it == segments_.end())
+            {
+                return;
+            }
+            SegmentPtr segment = it->second;
+            segment->liveBytes -= location.length;
+            if (segment->liveBytes == 0 && segment != active_)
+            {
+                dropSegment(segment);
+            }
+        }
+        // caller holds mutex_
+        void dropSegment(SegmentPtr segment)
+        {
+            for (const Key &key : segment->keys)
+            {
+                auto it = index_.find(key);
+                if (it != index_.end() && it->second.segment == segment->id)
+                {
+                    index_.erase(it);
+                }
+            }
+            totalBytes_ -= segment->size;
+            std::remove(segment->path.c_str());
+            segments_.erase(segment->id);
+            if (segment == active_)
+            {
+                active_.reset();
+            }
+        }
+
+        std::string path_;
+        size_t capacityBytes_;
+        size_t segmentBytes_;
+        Admission admission_;
+        std::mutex mutex_;
+        uint64_t nextSegment_;
+        size_t totalBytes_;
+        // ordered by id, so begin() is the oldest segment
+        std::map<uint64_t, SegmentPtr> segments_;
+        SegmentPtr active_;
+        std::unordered_map<Key, Location> index_;
+    };
+}
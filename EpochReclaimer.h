@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace mwm1cCache
+{
+    /**
+     * Epoch-based reclamation for lock-free structures. Readers pin the current global epoch for the
+     * duration of an EpochGuard; a writer that unlinks an object retires it instead of deleting it, tagged
+     * with the epoch at retirement. The global epoch only advances once every pinned thread has seen the
+     * current one, so after two advances no reader can still hold anything retired before them.
+     *
+     * Pinning is a store and a fence on a thread-private record, with no shared counters. Retired objects
+     * are freed in batches of BATCH per thread. Threads register on first use and their record is
+     * recycled when they exit; objects they left retired are handed to whoever collects next.
+     */
+    class EpochReclaimer
+    {
+    public:
+        using Deleter = void (*)(void *);
+
+        // process-wide instance, never destroyed so that exiting threads can always hand over
+        static EpochReclaimer &shared()
+        {
+            static EpochReclaimer *reclaimer = new EpochReclaimer();
+            return *reclaimer;
+        }
+
+        void enter()
+        {
+            Record &record = localRecord();
+            if (record.nesting++ == 0)
+            {
+                record.epoch.store(globalEpoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                // the announcement must be visible before any pointer is read
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+        void exit()
+        {
+            Record &record = localRecord();
+            if (--record.nesting == 0)
+            {
+                record.epoch.store(IDLE, std::memory_order_release);
+            }
+        }
+        // object must already be unreachable for new readers
+        template <typename T>
+        void retire(T *object)
+        {
+            retire(object, [](void *pointer) { delete static_cast<T *>(pointer); });
+        }
+        void retire(void *object, Deleter deleter)
+        {
+            Record &record = localRecord();
+            record.retired.push_back({object, deleter, globalEpoch_.load(std::memory_order_acquire)});
+            if (record.retired.size() >= BATCH)
+            {
+                collect(record);
+            }
+        }
+        // frees what this thread retired and is safe to free now, e.g. before a thread goes idle
+        void collect()
+        {
+            collect(localRecord());
+        }
+        uint64_t epoch() const
+        {
+            return globalEpoch_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr uint64_t IDLE = UINT64_MAX;
+        static constexpr size_t BATCH = 128;
+
+        struct Retired
+        {
+            void *object;
+            Deleter deleter;
+            uint64_t epoch;
+        };
+        struct alignas(64) Record
+        {
+            std::atomic<uint64_t> epoch{IDLE};
+            std::atomic<bool> claimed{true};
+            unsigned nesting = 0;
+            std::vector<Retired> retired;
+            Record *next = nullptr;
+        };
+        // releases the thread's record when the thread exits
+        struct RecordHolder
+        {
+            Record *record = nullptr;
+            ~RecordHolder()
+            {
+                if (record)
+                {
+                    shared().release(record);
+                }
+            }
+        };
+
+        EpochReclaimer()
+            : globalEpoch_(0), records_(nullptr)
+        {
+        }
+
+        Record &localRecord()
+        {
+            thread_local RecordHolder holder;
+            if (!holder.record)
+            {
+                holder.record = acquire();
+            }
+            return *holder.record;
+        }
+        Record *acquire()
+        {
+            for (Record *record = records_.load(std::memory_order_acquire); record; record = record->next)
+            {
+                bool claimed = false;
+                if (!record->claimed.load(std::memory_order_relaxed) &&
+                    record->claimed.compare_exchange_strong(claimed, true, std::memory_order_acquire))
+                {
+                    return record;
+                }
+            }
+            Record *record = new Record();
+            record->next = records_.load(std::memory_order_relaxed);
+            while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release))
+            {
+            }
+            return record;
+        }
+        void release(Record *record)
+        {
+            if (!record->retired.empty())
+            {
+                std::lock_guard<std::mutex> lock(orphanMutex_);
+                orphans_.insert(orphans_.end(), record->retired.begin(), record->retired.end());
+                record->retired.clear();
+            }
+            record->nesting = 0;
+            record->epoch.store(IDLE, std::memory_order_relaxed);
+            record->claimed.store(false, std::memory_order_release);
+        }
+
+        // the epoch moves on only when no thread is still pinned in an older one
+        void tryAdvance()
+        {
+            uint64_t current = globalEpoch_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (Record *record = records_.load(std::memory_order_acquire); record; record = record->next)
+            {
+                uint64_t pinned = record->epoch.load(std::memory_order_acquire);
+                if (pinned != IDLE && pinned != current)
+                {
+                    return;
+                }
+            }
+            globalEpoch_.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel);
+        }
+        static void freeExpired(std::vector<Retired> &retired, uint64_t safeBefore)
+        {
+            size_t kept = 0;
+            for (Retired &item : retired)
+            {
+                if (item.epoch + 2 <= safeBefore)
+                {
+                    item.deleter(item.object);
+                }
+                else
+                {
+                    retired[kept++] = item;
+                }
+            }
+            retired.resize(kept);
+        }
+        void collect(Record &record)
+        {
+            tryAdvance();
+            uint64_t current = globalEpoch_.load(std::memory_order_acquire);
+            freeExpired(record.retired, current);
+            std::unique_lock<std::mutex> lock(orphanMutex_, std::try_to_lock);
+            if (lock.owns_lock() && !orphans_.empty())
+            {
+                freeExpired(orphans_, current);
+            }
+        }
+
+        std::atomic<uint64_t> globalEpoch_;
+        // push-only list, records are recycled rather than freed
+        std::atomic<Record *> records_;
+        std::mutex orphanMutex_;
+        std::vector<Retired> orphans_;
+    };
+
+    // pins the current epoch for its lifetime; guards nest
+    class EpochGuard
+    {
+    public:
+        explicit EpochGuard(EpochReclaimer &reclaimer = EpochReclaimer::shared())
+            : reclaimer_(reclaimer)
+        {
+            reclaimer_.enter();
+        }
+        ~EpochGuard()
+        {
+            reclaimer_.exit();
+        }
+        EpochGuard(const EpochGuard &) = delete;
+        EpochGuard &operator=(const EpochGuard &) = delete;
+
+    private:
+        EpochReclaimer &reclaimer_;
+    };
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CachePolicy.h"
+
+namespace mwm1cCache
+{
+    /**
+     * LRU cache for std::string keys that stores every key exactly once, in an append-only byte arena.
+     * Nodes live in one array and link each other by index; they refer to their key by arena offset.
+     * The index is an open-addressing table of 8-byte entries (32-bit hash | node index + 1), so almost
+     * every mismatch is rejected on the hash without touching the node or the key bytes.
+     *
+     * Removed keys leave holes in the arena; once they make up more than half of it, the live keys are
+     * copied into a fresh arena. Each instance is one shard with its own arena and lock.
+     */
+    template <typename Value>
+    class InternedLruCache : public CachePolicy<std::string, Value>
+    {
+    public:
+        explicit InternedLruCache(int cap)
+            : capacity_(cap > 0 ? static_cast<uint32_t>(cap) : 0), head_(NIL), tail_(NIL), freeNodes_(NIL),
+              size_(0), deadBytes_(0)
+        {
+            size_t tableSize = 2;
+            while (tableSize < static_cast<size_t>(capacity_) * 2)
+            {
+                tableSize <<= 1;
+            }
+            table_.assign(tableSize, 0);
+            nodes_.reserve(capacity_);
+        }
+        ~InternedLruCache() override = default;
+
+        void put(std::string key, Value value) override
+        {
+            if (capacity_ == 0)
+            {
+                return;
+            }
+            uint32_t hash = hashOf(key);
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t slot = find(key, hash);
+            if (slot != NPOS)
+            {
+                uint32_t node = nodeOf(table_[slot]);
+                nodes_[node].value = value;
+                moveToMostRecent(node);
+                return;
+            }
+            if (size_ >= capacity_)
+            {
+                evictLeastRecent();
+            }
+            uint32_t node = allocateNode();
+            Node &entry = nodes_[node];
+            entry.keyOffset = intern(key);
+            entry.keyLength = static_cast<uint32_t>(key.size());
+            entry.value = value;
+            linkMostRecent(node);
+            insert(hash, node);
+            ++size_;
+        }
+        bool get(std::string key, Value &value) override
+        {
+            uint32_t hash = hashOf(key);
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t slot = find(key, hash);
+            if (slot == NPOS)
+            {
+                return false;
+            }
+            uint32_t node = nodeOf(table_[slot]);
+            moveToMostRecent(node);
+            value = nodes_[node].value;
+            return true;
+        }
+        Value get(std::string key) override
+        {
+            Value value{};
+            get(key, value);
+            return value;
+        }
+        void remove(const std::string &key)
+        {
+            uint32_t hash = hashOf(key);
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t slot = find(key, hash);
+            if (slot != NPOS)
+            {
+                uint32_t node = nodeOf(table_[slot]);
+                erase(slot);
+                releaseNode(node);
+            }
+        }
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return size_;
+        }
+        // bytes held by the key arena, including holes not compacted yet
+        size_t arenaBytes()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return arena_.size();
+        }
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr size_t NPOS = SIZE_MAX;
+        static constexpr size_t MIN_COMPACT_BYTES = 64 * 1024;
+
+        struct Node
+        {
+            uint32_t keyOffset = 0;
+            uint32_t keyLength = 0;
+            uint32_t hash = 0;
+            uint32_t prev = NIL;
+            uint32_t next = NIL;
+            Value value{};
+        };
+
+        static uint32_t hashOf(const std::string &key)
+        {
+            uint64_t hash = std::hash<std::string>()(key);
+            return static_cast<uint32_t>(hash ^ (hash >> 32));
+        }
+        static uint32_t nodeOf(uint64_t entry)
+        {
+            return static_cast<uint32_t>(entry) - 1;
+        }
+        static uint32_t hashOfEntry(uint64_t entry)
+        {
+            return static_cast<uint32_t>(entry >> 32);
+        }
+
+        size_t find(const std::string &key, uint32_t hash) const
+        {
+            size_t mask = table_.size() - 1;
+            for (size_t slot = hash & mask; table_[slot]; slot = (slot + 1) & mask)
+            {
+                if (hashOfEntry(table_[slot]) != hash)
+                {
+                    continue;
+                }
+                const Node &node = nodes_[nodeOf(table_[slot])];
+                if (node.keyLength == key.size() && std::memcmp(arena_.data() + node.keyOffset, key.data(), key.size()) == 0)
+                {
+                    return slot;
+                }
+            }
+            return NPOS;
+        }
+        void insert(uint32_t hash, uint32_t node)
+        {
+            nodes_[node].hash = hash;
+            size_t mask = table_.size() - 1;
+            size_t slot = hash & mask;
+            while (table_[slot])
+            {
+                slot = (slot + 1) & mask;
+            }
+            table_[slot] = (static_cast<uint64_t>(hash) << 32) | (node + 1);
+        }
+        // backward-shift deletion keeps probe chains intact without tombstones
+        void erase(size_t slot)
+        {
+            size_t mask = table_.size() - 1;
+            for (size_t next = (slot + 1) & mask; table_[next]; next = (next + 1) & mask)
+            {
+                size_t ideal = hashOfEntry(table_[next]) & mask;
+                if (((next - ideal) & mask) >= ((next - slot) & mask))
+                {
+                    table_[slot] = table_[next];
+                    slot = next;
+                }
+            }
+            table_[slot] = 0;
+        }
+
+        uint32_t intern(const std::string &key)
+        {
+            if (deadBytes_ > MIN_COMPACT_BYTES && deadBytes_ * 2 > arena_.size())
+            {
+                compactArena();
+            }
+            uint32_t offset = static_cast<uint32_t>(arena_.size());
+            arena_.insert(arena_.end(), key.begin(), key.end());
+            return offset;
+        }
+        void compactArena()
+        {
+            std::vector<char> arena;
+            arena.reserve(arena_.size() - deadBytes_ + arena_.size() / 4);
+            for (uint32_t node = head_; node != NIL; node = nodes_[node].next)
+            {
+                Node &entry = nodes_[node];
+                uint32_t offset = static_cast<uint32_t>(arena.size());
+                arena.insert(arena.end(), arena_.begin() + entry.keyOffset, arena_.begin() + entry.keyOffset + entry.keyLength);
+                entry.keyOffset = offset;
+            }
+            arena_.swap(arena);
+            deadBytes_ = 0;
+        }
+
+        uint32_t allocateNode()
+        {
+            if (freeNodes_ != NIL)
+            {
+                uint32_t node = freeNodes_;
+                freeNodes_ = nodes_[node].next;
+                return node;
+            }
+            nodes_.emplace_back();
+            return static_cast<uint32_t>(nodes_.size() - 1);
+        }
+        void releaseNode(uint32_t node)
+        {
+            unlink(node);
+            Node &entry = nodes_[node];
+            deadBytes_ += entry.keyLength;
+            entry.value = Value{};
+            entry.next = freeNodes_;
+            freeNodes_ = node;
+            --size_;
+        }
+        void evictLeastRecent()
+        {
+            uint32_t node = head_;
+            Node &entry = nodes_[node];
+            size_t mask = table_.size() - 1;
+            size_t slot = entry.hash & mask;
+            while (nodeOf(table_[slot]) != node)
+            {
+                slot = (slot + 1) & mask;
+            }
+            erase(slot);
+            releaseNode(node);
+        }
+        // head_ is the least recent node, tail_ the most recent
+        void linkMostRecent(uint32_t node)
+        {
+            nodes_[node].prev = tail_;
+            nodes_[node].next = NIL;
+            if (tail_ != NIL)
+            {
+                nodes_[tail_].next = node;
+            }
+            else
+            {
+                head_ = node;
+            }
+            tail_ = node;
+        }
+        void unlink(uint32_t node)
+        {
+            Node &entry = nodes_[node];
+            if (entry.prev != NIL)
+            {
+                nodes_[entry.prev].next = entry.next;
+            }
+            else
+            {
+                head_ = entry.next;
+            }
+            if (entry.next != NIL)
+            {
+                nodes_[entry.next].prev = entry.prev;
+            }
+            else
+            {
+                tail_ = entry.prev;
+            }
+            entry.prev = entry.next = NIL;
+        }
+        void moveToMostRecent(uint32_t node)
+        {
+            if (node != tail_)
+            {
+                unlink(node);
+                linkMostRecent(node);
+            }
+        }
+
+        uint32_t capacity_;
+        std::mutex mutex_;
+        std::vector<char> arena_;
+        std::vector<Node> nodes_;
+        std::vector<uint64_t> table_;
+        uint32_t head_;
+        uint32_t tail_;
+        uint32_t freeNodes_;
+        uint32_t size_;
+        size_t deadBytes_;
+    };
+}
@@ -1,12 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
 #include <vector>
+#include "BloomFilter.h"
+#include "CacheLoader.h"
 #include "CachePolicy.h"
+#include "CacheScan.h"
+#include "CacheSnapshot.h"
+#include "MaintenanceScheduler.h"
+#include "OperationLog.h"
+#include "RemovalListener.h"
+#include "ShardedPersistence.h"
 
 namespace mwm1cCache
 {
@@ -84,26 +95,50 @@ namespace mwm1cCache
 
         LfuCache(int cap, int maxAvgNum = 1000000)
             : capacity_(cap), minFreq_(INT8_MAX),
-              maxAvgNum_(maxAvgNum), curAvgNum_(0), curTotalNum_(0)
+              maxAvgNum_(maxAvgNum), curAvgNum_(0), curTotalNum_(0), maintenance_(nullptr), maintenanceTask_(0),
+              lowWatermark_(0), highWatermark_(0), evictingAhead_(false), aging_(false), agingBucket_(0),
+              agingBucketCount_(0), maintenanceWoken_(false)
         {
         }
-        ~LfuCache() override = default;
+        ~LfuCache() override
+        {
+            disableMaintenance();
+        }
         void put(Key key, Value value) override
         {
             if (!capacity_)
                 return;
-            std::lock_guard<std::mutex> lock(mutex_);
-            auto it = nodeMap_.find(key);
-            if (it != nodeMap_.end())
             {
-                it->second->value = value;
-                getInternal(it->second, value);
-                return;
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = nodeMap_.find(key);
+                if (it != nodeMap_.end())
+                {
+                    notifier_.enqueue(it->second->key, it->second->value, RemovalCause::Replaced);
+                    it->second->value = value;
+                    getInternal(it->second, value);
+                }
+                else
+                {
+                    putInternal(key, value);
+                }
+                if (opLog_)
+                {
+                    opLog_->appendPut(key, value);
+                }
+                if (maintenance_ && nodeMap_.size() >= static_cast<size_t>(highWatermark_))
+                {
+                    requestMaintenance();
+                }
             }
-            putInternal(key, value);
+            notifier_.dispatch();
         }
         bool get(Key key, Value &value) override
         {
+            // a definite miss never takes the lock
+            if (!mayContain(key))
+            {
+                return false;
+            }
             std::lock_guard<std::mutex> lock(mutex_);
             auto it = nodeMap_.find(key);
             if (it != nodeMap_.end())
@@ -119,17 +154,263 @@ namespace mwm1cCache
             get(key, value);
             return value;
         }
+        // read-only lookup: the frequency is left alone
+        bool peek(const Key &key, Value &value)
+        {
+            if (!mayContain(key))
+            {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = nodeMap_.find(key);
+            if (it == nodeMap_.end())
+            {
+                return false;
+            }
+            value = it->second->value;
+            return true;
+        }
         void purge()
         {
-            nodeMap_.clear();
-            for (auto &pair : freqToFreqList_)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (notifier_.hasListeners())
+                {
+                    for (auto &pair : nodeMap_)
+                    {
+                        notifier_.enqueue(pair.second->key, pair.second->value, RemovalCause::Explicit);
+                    }
+                }
+                nodeMap_.clear();
+                for (auto &pair : freqToFreqList_)
+                {
+                    delete pair.second;
+                }
+                freqToFreqList_.clear();
+                if (CountingBloomFilter *filter = filter_.load(std::memory_order_relaxed))
+                {
+                    filter->clear();
+                }
+                if (opLog_)
+                {
+                    opLog_->appendClear();
+                }
+            }
+            notifier_.dispatch();
+        }
+        // listeners run on a thread that has just released the cache lock, never under it
+        void addRemovalListener(typename RemovalNotifier<Key, Value>::Listener listener)
+        {
+            notifier_.addListener(std::move(listener));
+        }
+        /**
+         * Puts a counting bloom filter in front of get(): it is maintained under the lock on insert and
+         * eviction and read lock-free, so most lookups of absent keys return without touching the mutex.
+         * Can be enabled once; later calls keep the first filter.
+         */
+        void enableBloomFilter(size_t countersPerKey = 16)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (filter_.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            filterOwner_ = std::make_unique<CountingBloomFilter>(capacity_, countersPerKey);
+            for (auto &pair : nodeMap_)
+            {
+                filterOwner_->add(filterHash(pair.first));
+            }
+            filter_.store(filterOwner_.get(), std::memory_order_release);
+        }
+        // false means key is definitely not cached, true that it may be
+        bool mayContain(const Key &key) const
+        {
+            CountingBloomFilter *filter = filter_.load(std::memory_order_acquire);
+            return !filter || filter->mayContain(filterHash(key));
+        }
+        // visitor(key, value) for every entry, outside the lock and without touching frequencies (see scanChunked)
+        template <typename Visitor>
+        size_t forEach(Visitor visitor)
+        {
+            return scanChunked<Key, Value>(mutex_, nodeMap_, [](const NodePtr &node, Value &value) {
+                value = node->value;
+                return true;
+            }, visitor);
+        }
+        /**
+         * Moves housekeeping off the request path onto scheduler: frequency aging no longer walks the whole
+         * cache inside the put or get that crosses maxAvgNum, a background task ages MAINTENANCE_CHUNK
+         * entries per slice instead; and once a put fills the cache to highPercent of its capacity, the
+         * task evicts down to lowPercent so puts find free room. A put at full capacity still evicts
+         * inline. The scheduler must outlive the cache.
+         */
+        void enableMaintenance(MaintenanceScheduler &scheduler, int lowPercent = 90, int highPercent = 95)
+        {
+            disableMaintenance();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                highWatermark_ = std::max(1, capacity_ * std::min(highPercent, 100) / 100);
+                lowWatermark_ = std::min(highWatermark_ - 1, capacity_ * std::max(lowPercent, 0) / 100);
+                maintenance_ = &scheduler;
+            }
+            maintenanceTask_ = scheduler.add([this]() { return maintain(); });
+        }
+        // back to inline housekeeping; waits for a running slice to finish
+        void disableMaintenance()
+        {
+            MaintenanceScheduler *scheduler;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                scheduler = maintenance_;
+                maintenance_ = nullptr;
+                aging_ = false;
+            }
+            if (scheduler)
+            {
+                scheduler->remove(maintenanceTask_);
+            }
+        }
+        // puts and purges are appended to the log under the cache lock, so it replays in cache order
+        void enableOperationLog(std::shared_ptr<OperationLog<Key, Value>> opLog)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            opLog_ = std::move(opLog);
+        }
+        /**
+         * payload: uint64 count, uint64 list count, then per frequency list in ascending frequency order:
+         * int32 freq, uint64 size and size (key, value) pairs in the list's eviction order
+         */
+        bool saveSnapshot(const std::string &path)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return writeSnapshot(path);
+        }
+        /**
+         * Replaces the contents with a snapshot, keeping every entry's frequency. The frequency lists are
+         * built straight from the mapped file and swapped in under the lock; a snapshot larger than the
+         * capacity loses its least frequent entries. On failure the cache is left untouched.
+         */
+        bool loadSnapshot(const std::string &path)
+        {
+            SnapshotReader reader;
+            uint64_t count = 0;
+            uint64_t listCount = 0;
+            if (!reader.open(path, SnapshotPolicy::Lfu) || !reader.read(count) || !reader.read(listCount))
+            {
+                return false;
+            }
+            uint64_t skip = count > static_cast<uint64_t>(capacity_) ? count - capacity_ : 0;
+            NodeMap nodeMap;
+            nodeMap.reserve(count - skip);
+            std::unordered_map<int, FreqList<Key, Value> *> freqToFreqList;
+            int totalNum = 0;
+            bool ok = true;
+            for (uint64_t i = 0; i < listCount && ok; ++i)
+            {
+                int32_t freq = 0;
+                uint64_t size = 0;
+                ok = reader.read(freq) && reader.read(size) && freq > 0;
+                for (uint64_t j = 0; j < size && ok; ++j)
+                {
+                    Key key{};
+                    Value value{};
+                    ok = reader.read(key) && reader.read(value);
+                    if (!ok)
+                    {
+                        break;
+                    }
+                    if (skip > 0)
+                    {
+                        --skip;
+                        continue;
+                    }
+                    NodePtr node = std::make_shared<Node>(key, value);
+                    node->freq = freq;
+                    if (freqToFreqList.find(freq) == freqToFreqList.end())
+                    {
+                        freqToFreqList[freq] = new FreqList<Key, Value>(freq);
+                    }
+                    freqToFreqList[freq]->addNode(node);
+                    nodeMap[key] = node;
+                    totalNum += freq;
+                }
+            }
+            if (!ok || !reader.atEnd())
+            {
+                for (auto &pair : freqToFreqList)
+                {
+                    delete pair.second;
+                }
+                return false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                nodeMap_.swap(nodeMap);
+                freqToFreqList_.swap(freqToFreqList);
+                curTotalNum_ = totalNum;
+                curAvgNum_ = nodeMap_.empty() ? 0 : curTotalNum_ / static_cast<int>(nodeMap_.size());
+                updateMinFreq();
+                if (CountingBloomFilter *filter = filter_.load(std::memory_order_relaxed))
+                {
+                    filter->clear();
+                    for (auto &pair : nodeMap_)
+                    {
+                        filter->add(filterHash(pair.first));
+                    }
+                }
+            }
+            // the replaced lists are released outside the lock
+            for (auto &pair : freqToFreqList)
             {
                 delete pair.second;
             }
-            freqToFreqList_.clear();
+            return true;
         }
 
     private:
+        friend class BackgroundSnapshot;
+        static constexpr size_t MAINTENANCE_CHUNK = 256;
+
+        // caller holds mutex_, or is a forked child that owns a private copy of the cache
+        bool writeSnapshot(const std::string &path)
+        {
+            SnapshotWriter writer(SnapshotPolicy::Lfu);
+            if (!writer.open(path))
+            {
+                return false;
+            }
+            std::vector<std::pair<int, FreqList<Key, Value> *>> lists;
+            for (auto &pair : freqToFreqList_)
+            {
+                if (pair.second && !pair.second->isEmpty())
+                {
+                    lists.push_back(pair);
+                }
+            }
+            std::sort(lists.begin(), lists.end());
+            writer.write(static_cast<uint64_t>(nodeMap_.size()));
+            writer.write(static_cast<uint64_t>(lists.size()));
+            for (auto &pair : lists)
+            {
+                std::vector<NodePtr> nodes;
+                for (NodePtr node = pair.second->getFirstNode(); node != pair.second->tail_; node = node->next)
+                {
+                    nodes.push_back(node);
+                }
+                writer.write(static_cast<int32_t>(pair.first));
+                writer.write(static_cast<uint64_t>(nodes.size()));
+                for (auto &node : nodes)
+                {
+                    writer.write(node->key);
+                    writer.write(node->value);
+                }
+            }
+            return writer.commit();
+        }
+        static uint64_t filterHash(const Key &key)
+        {
+            return CountingBloomFilter::mix(std::hash<Key>()(key));
+        }
         void putInternal(Key key, Value value)
         {
             if (nodeMap_.size() == capacity_)
@@ -138,6 +419,10 @@ namespace mwm1cCache
             }
             NodePtr node = std::make_shared<Node>(key, value);
             nodeMap_[key] = node;
+            if (CountingBloomFilter *filter = filter_.load(std::memory_order_relaxed))
+            {
+                filter->add(filterHash(key));
+            }
             addToFreqList(node);
             addFreqNum();
             minFreq_ = std::min(minFreq_, 1);
@@ -166,7 +451,12 @@ namespace mwm1cCache
             NodePtr node = freqToFreqList_[minFreq_]->getFirstNode();
             removeFromFreqList(node);
             nodeMap_.erase(node->key);
+            if (CountingBloomFilter *filter = filter_.load(std::memory_order_relaxed))
+            {
+                filter->remove(filterHash(node->key));
+            }
             decreaseFreqNum(node->freq);
+            notifier_.enqueue(node->key, node->value, RemovalCause::Size);
         }
         void removeFromFreqList(NodePtr node)
         {
@@ -203,7 +493,14 @@ namespace mwm1cCache
             }
             if (curAvgNum_ > maxAvgNum_)
             {
-                handleOverMaxAvgNum();
+                if (maintenance_)
+                {
+                    requestMaintenance();
+                }
+                else
+                {
+                    handleOverMaxAvgNum();
+                }
             }
         }
         void decreaseFreqNum(int num)
@@ -245,6 +542,92 @@ namespace mwm1cCache
             }
             updateMinFreq();
         }
+        // caller holds mutex_; wakes the scheduler once per slice, it never holds its lock while running one
+        void requestMaintenance()
+        {
+            if (!maintenanceWoken_.exchange(true, std::memory_order_relaxed))
+            {
+                maintenance_->wake();
+            }
+        }
+        /**
+         * One slice of background housekeeping, returns whether there is more. Eviction ahead runs from the
+         * high to the low watermark. An aging pass walks the buckets like handleOverMaxAvgNum walks the
+         * map, but a chunk at a time; unlike it, the pass also takes the removed counts off curTotalNum_,
+         * so it ends the inflation instead of being retriggered by every access. A rehash between two
+         * chunks ends the pass early rather than aging some entries twice.
+         */
+        bool maintain()
+        {
+            bool more = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                maintenanceWoken_.store(false, std::memory_order_relaxed);
+                size_t work = 0;
+                evictingAhead_ = evictingAhead_ || nodeMap_.size() >= static_cast<size_t>(highWatermark_);
+                while (evictingAhead_ && nodeMap_.size() > static_cast<size_t>(lowWatermark_) && work < MAINTENANCE_CHUNK)
+                {
+                    // kickOut leaves minFreq_ on the emptied list, putInternal would have reset it
+                    if (minFreqListEmpty())
+                    {
+                        updateMinFreq();
+                    }
+                    kickOut();
+                    ++work;
+                }
+                evictingAhead_ = evictingAhead_ && nodeMap_.size() > static_cast<size_t>(lowWatermark_);
+                // with maxAvgNum_ below 2 a pass would not lower any count
+                if (!aging_ && curAvgNum_ > maxAvgNum_ && maxAvgNum_ / 2 > 0)
+                {
+                    aging_ = true;
+                    agingBucket_ = 0;
+                    agingBucketCount_ = nodeMap_.bucket_count();
+                }
+                if (aging_)
+                {
+                    ageChunk(work);
+                }
+                if (!nodeMap_.empty() && minFreqListEmpty())
+                {
+                    updateMinFreq();
+                }
+                more = evictingAhead_ || aging_;
+            }
+            notifier_.dispatch();
+            return more;
+        }
+        bool minFreqListEmpty() const
+        {
+            auto it = freqToFreqList_.find(minFreq_);
+            return it == freqToFreqList_.end() || !it->second || it->second->isEmpty();
+        }
+        // caller holds mutex_
+        void ageChunk(size_t work)
+        {
+            if (agingBucketCount_ == nodeMap_.bucket_count())
+            {
+                for (; agingBucket_ < agingBucketCount_ && work < MAINTENANCE_CHUNK; ++agingBucket_)
+                {
+                    for (auto it = nodeMap_.begin(agingBucket_); it != nodeMap_.end(agingBucket_); ++it, ++work)
+                    {
+                        NodePtr node = it->second;
+                        removeFromFreqList(node);
+                        int freq = std::max(1, node->freq - maxAvgNum_ / 2);
+                        curTotalNum_ -= node->freq - freq;
+                        node->freq = freq;
+                        addToFreqList(node);
+                        // entries only move down, so the minimum stays on a non-empty list
+                        minFreq_ = std::min(minFreq_, freq);
+                    }
+                }
+                if (agingBucket_ < agingBucketCount_)
+                {
+                    return;
+                }
+            }
+            aging_ = false;
+            curAvgNum_ = nodeMap_.empty() ? 0 : curTotalNum_ / static_cast<int>(nodeMap_.size());
+        }
         void updateMinFreq()
         {
             minFreq_ = INT8_MAX;
@@ -270,6 +653,23 @@ namespace mwm1cCache
         std::mutex mutex_;
         NodeMap nodeMap_;
         std::unordered_map<int, FreqList<Key, Value> *> freqToFreqList_;
+        RemovalNotifier<Key, Value> notifier_;
+        std::shared_ptr<OperationLog<Key, Value>> opLog_;
+        // published once by enableBloomFilter(), read without the lock by get()
+        std::unique_ptr<CountingBloomFilter> filterOwner_;
+        std::atomic<CountingBloomFilter *> filter_{nullptr};
+        MaintenanceScheduler *maintenance_;
+        MaintenanceScheduler::TaskId maintenanceTask_;
+        int lowWatermark_;
+        int highWatermark_;
+        // set at the high watermark, cleared once the low one is reached
+        bool evictingAhead_;
+        // an aging pass is under way, from agingBucket_ to agingBucketCount_
+        bool aging_;
+        size_t agingBucket_;
+        size_t agingBucketCount_;
+        // a wake-up is pending, saves the scheduler lock on every access that would trigger it
+        std::atomic<bool> maintenanceWoken_;
     };
 
     template <typename Key, typename Value>
@@ -280,9 +680,10 @@ namespace mwm1cCache
             : capacity_(cap), sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency())
         {
             size_t sliceSize = std::ceil(cap / static_cast<double>(sliceNum_));
-            for (int i = 0; i < sliceNum; ++ i)
+            for (int i = 0; i < sliceNum_; ++ i)
             {
                 lfuSliceCaches_.emplace_back(new LfuCache<Key, Value>(sliceSize, maxAvgNum));
+                sliceLoading_.emplace_back(new LoadingCache<Key, Value, LfuCache<Key, Value>>(*lfuSliceCaches_.back()));
             }
         }
         void put(Key key, Value value)
@@ -301,6 +702,18 @@ namespace mwm1cCache
             get(key, value);
             return value;
         }
+        template <typename Loader>
+        Value getOrLoad(Key key, Loader loader)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return sliceLoading_[sliceIndex]->getOrLoad(key, loader);
+        }
+        template <typename Loader>
+        std::shared_future<Value> getAsync(Key key, Loader loader, CacheExecutor &executor)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return sliceLoading_[sliceIndex]->getAsync(key, loader, executor);
+        }
         void purge()
         {
             for (auto &lfuSliceCache : lfuSliceCaches_)
@@ -308,6 +721,101 @@ namespace mwm1cCache
                 lfuSliceCache->purge();
             }
         }
+        // slices one after another; scan() is the parallel variant
+        template <typename Visitor>
+        size_t forEach(Visitor visitor)
+        {
+            return scanSlices(lfuSliceCaches_, 1, std::move(visitor));
+        }
+        // walks up to threads slices at a time, so the visitor must be thread-safe
+        template <typename Visitor>
+        size_t scan(Visitor visitor, int threads)
+        {
+            return scanSlices(lfuSliceCaches_, threads, std::move(visitor));
+        }
+        // each slice filters its own share of the keys, sized from its own capacity
+        void enableBloomFilter(size_t countersPerKey = 16)
+        {
+            for (auto &lfuSliceCache : lfuSliceCaches_)
+            {
+                lfuSliceCache->enableBloomFilter(countersPerKey);
+            }
+        }
+        bool mayContain(Key key)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return lfuSliceCaches_[sliceIndex]->mayContain(key);
+        }
+        // every slice gets its own task on the shared scheduler
+        void enableMaintenance(MaintenanceScheduler &scheduler, int lowPercent = 90, int highPercent = 95)
+        {
+            for (auto &lfuSliceCache : lfuSliceCaches_)
+            {
+                lfuSliceCache->enableMaintenance(scheduler, lowPercent, highPercent);
+            }
+        }
+        void disableMaintenance()
+        {
+            for (auto &lfuSliceCache : lfuSliceCaches_)
+            {
+                lfuSliceCache->disableMaintenance();
+            }
+        }
+        void addRemovalListener(typename RemovalNotifier<Key, Value>::Listener listener)
+        {
+            for (auto &lfuSliceCache : lfuSliceCaches_)
+            {
+                lfuSliceCache->addRemovalListener(listener);
+            }
+        }
+        // foreground dump, one "<path>.<slice index>" file per slice
+        bool saveSnapshot(const std::string &path)
+        {
+            return persistence_.saveSnapshot(lfuSliceCaches_, path);
+        }
+        // slices are matched to files by index, so the slice count must be the one the snapshot was taken with
+        bool loadSnapshot(const std::string &path)
+        {
+            return persistence_.loadSnapshot(lfuSliceCaches_, path);
+        }
+        /**
+         * Starts a fork()-based dump of all slices and returns right away; traffic is only blocked while
+         * the process forks. Collect the result with waitSnapshot() before starting the next one.
+         */
+        bool saveSnapshotInBackground(const std::string &path)
+        {
+            return persistence_.saveSnapshotInBackground(lfuSliceCaches_, path);
+        }
+        bool snapshotRunning()
+        {
+            return persistence_.snapshotRunning();
+        }
+        bool waitSnapshot()
+        {
+            return persistence_.waitSnapshot();
+        }
+        /**
+         * Logs every put/purge per slice and syncs all logs every commitInterval. Snapshots saved to the
+         * same path truncate the logs, so recover(path) only replays what happened after the last one.
+         */
+        void enableOperationLog(const std::string &path, std::chrono::milliseconds commitInterval)
+        {
+            persistence_.enableOperationLog(lfuSliceCaches_, path, commitInterval);
+        }
+        // rebuilds every slice in parallel from its snapshot and log, call before enableOperationLog()
+        void recover(const std::string &path)
+        {
+            persistence_.recover(lfuSliceCaches_, path, [](LfuCache<Key, Value> &slice, LogOp op, const Key &key, const Value &value) {
+                if (op == LogOp::Put)
+                {
+                    slice.put(key, value);
+                }
+                else if (op == LogOp::Clear)
+                {
+                    slice.purge();
+                }
+            });
+        }
 
     private:
         size_t Hash(Key key)
@@ -320,5 +828,9 @@ namespace mwm1cCache
         size_t capacity_;
         int sliceNum_;
         std::vector<std::unique_ptr<LfuCache<Key, Value>>> lfuSliceCaches_;
+        // one single-flight table per slice, so misses on different slices never share a lock
+        std::vector<std::unique_ptr<LoadingCache<Key, Value, LfuCache<Key, Value>>>> sliceLoading_;
+        // declared last: stops the log committer and reaps a running dump child before the slices go away
+        ShardedPersistence<Key, Value> persistence_;
     };
 }
\ No newline at end of file
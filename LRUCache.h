@@ -1,16 +1,37 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include "CacheExecutor.h"
+#include "CacheLoader.h"
+#include "CacheLock.h"
 #include "CachePolicy.h"
+#include "CacheScan.h"
+#include "CacheSnapshot.h"
+#include "MaintenanceScheduler.h"
+#include "OperationLog.h"
+#include "RemovalListener.h"
+#include "ShardedPersistence.h"
+#include "WriteBehind.h"
 
 namespace mwm1cCache
 {
-    template <typename Key, typename Value>
+    template <typename Key, typename Value, typename Mutex = std::mutex>
     class LruCache;
 
     template <typename Key, typename Value>
@@ -20,12 +41,23 @@ namespace mwm1cCache
         Key key_;
         Value value_;
         size_t accessCount_;
+        // when the value was last written, only maintained while expiry is enabled
+        std::chrono::steady_clock::time_point loadTime_;
+        // last move to the most recent end, only maintained while promotion throttling is enabled
+        std::chrono::steady_clock::time_point promotedAt_;
+        // insertion time, only maintained while midpoint insertion has a promotion delay
+        std::chrono::steady_clock::time_point insertedAt_;
+        bool refreshing_;
+        // in the young sublist, only ever set with midpoint insertion
+        bool young_;
+        // tags given to the put that stored the value
+        std::vector<std::string> tags_;
         std::weak_ptr<LruNode<Key, Value>> prev_;
         std::shared_ptr<LruNode<Key, Value>> next_;
 
     public:
         LruNode(Key key, Value value)
-            : key_(key), value_(value), accessCount_(1)
+            : key_(key), value_(value), accessCount_(1), refreshing_(false), young_(false)
         {
         }
         Key getKey() const
@@ -48,50 +80,123 @@ namespace mwm1cCache
             ++accessCount_;
         }
 
-        friend class LruCache<Key, Value>;
+        template <typename, typename, typename>
+        friend class LruCache;
     };
 
-    // version 1
-    template <typename Key, typename Value>
+    // outcome of a lookup on a cache with negative caching
+    enum class LookupResult
+    {
+        Hit,         // value present
+        NegativeHit, // key cached as absent from the backend
+        Miss         // nothing known, ask the backend
+    };
+
+    /**
+     * version 1
+     * Mutex guards every operation: std::mutex, NullMutex when the cache is thread-confined or already
+     * behind an outer lock, SpinMutex for short uncontended sections, std::shared_mutex so that peek()
+     * and forEach() run concurrently with each other (see CacheLock.h).
+     */
+    template <typename Key, typename Value, typename Mutex>
     class LruCache : public CachePolicy<Key, Value>
     {
     public:
         using LruNodeType = LruNode<Key, Value>;
         using NodePtr = std::shared_ptr<LruNodeType>;   // be careful
         using NodeMap = std::unordered_map<Key, NodePtr>;
-        LruCache(int cap) : capacity_(cap)
+        using Clock = std::chrono::steady_clock;
+        using Reloader = std::function<Value(const Key &)>;
+        using Weigher = std::function<size_t(const Key &, const Value &)>;
+        LruCache(int cap)
+            : capacity_(cap), maxWeight_(0), totalWeight_(0), expireAfter_(Clock::duration::zero()),
+              refreshAfter_(Clock::duration::zero()), executor_(nullptr), promoteInterval_(Clock::duration::zero()),
+              maintenance_(nullptr), maintenanceTask_(0), lowWatermark_(0), highWatermark_(0), evictingAhead_(false),
+              sweepBucket_(0), maintenanceWoken_(false), youngCapacity_(0), youngCount_(0),
+              oldBlocksTime_(Clock::duration::zero())
         {
             initializeList();
         }
-        ~LruCache() override = default;
+        ~LruCache() override
+        {
+            disableMaintenance();
+            waitForRefreshes();
+            releaseChain(dummyHead_);
+        }
         void put(Key key, Value value) override
         {
-            if (capacity_ <= 0)
-                return;
-            std::lock_guard<std::mutex> lock(mutex_);
-            auto it = nodeMap_.find(key);
-            if (it != nodeMap_.end())
-            {
-                /**
-                 * If the key is in the current container, update the value and call the get method,
-                 * indicating that the data has just been accessed.
-                 */
-                updateExistingNode(it->second, value);
-                return;
-            }
-            addNewNode(key, value);
+            put(std::move(key), std::move(value), {});
+        }
+        /**
+         * Stores the value under key and files it under every tag, for invalidateTag(). Tags belong to the
+         * stored value: a later put of the key replaces them. They are not written to snapshots or logs.
+         */
+        void put(Key key, Value value, std::vector<std::string> tags)
+        {
+            putEntry(std::move(key), std::move(value), std::move(tags), true);
+        }
+        /**
+         * Stores a value that was just read from the backend: a put that never marks the entry dirty, so
+         * write-behind does not write it back where it came from. Read-through paths fill with this.
+         */
+        void putLoaded(Key key, Value value)
+        {
+            putEntry(std::move(key), std::move(value), {}, false);
         }
         bool get(Key key, Value &value) override
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            auto it = nodeMap_.find(key);
-            if (it != nodeMap_.end())
+            if constexpr (SHARED_HITS)
             {
-                moveToMostRecent(it->second);
-                value = it->second->getValue();
-                return true;
+                if (promoteInterval_.load(std::memory_order_relaxed) > Clock::duration::zero())
+                {
+                    std::optional<bool> hit = getUnpromoted(key, value);
+                    if (hit)
+                    {
+                        return *hit;
+                    }
+                }
             }
-            return false;
+            bool needRefresh = false;
+            bool expired = false;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                auto it = nodeMap_.find(key);
+                if (it == nodeMap_.end())
+                {
+                    return findWritingBack(key, value);
+                }
+                NodePtr node = it->second;
+                if (expireAfter_ > Clock::duration::zero())
+                {
+                    auto age = Clock::now() - node->loadTime_;
+                    if (age >= expireAfter_)
+                    {
+                        expireEntry(it);
+                        expired = true;
+                    }
+                    // stale but not expired: serve the current value and reload once in the background
+                    else if (reloader_ && age >= refreshAfter_ && !node->refreshing_)
+                    {
+                        node->refreshing_ = true;
+                        needRefresh = true;
+                    }
+                }
+                if (!expired)
+                {
+                    promote(node);
+                    value = node->getValue();
+                }
+            }
+            if (expired)
+            {
+                notifier_.dispatch();
+                return false;
+            }
+            if (needRefresh)
+            {
+                scheduleRefresh(key);
+            }
+            return true;
         }
         Value get(Key key) override
         {
@@ -99,18 +204,534 @@ namespace mwm1cCache
             get(key, value);
             return value;
         }
-        void remove(Key key)
+        // read-only lookup: no recency update, no expiry removal, shared lock with std::shared_mutex
+        bool peek(const Key &key, Value &value)
         {
-            std::lock_guard<std::mutex> lock(mutex_);
+            ReadLock<Mutex> lock(mutex_);
             auto it = nodeMap_.find(key);
-            if (it != nodeMap_.end())
+            if (it == nodeMap_.end())
+            {
+                return findWritingBack(key, value);
+            }
+            if (expireAfter_ > Clock::duration::zero() && Clock::now() - it->second->loadTime_ >= expireAfter_)
+            {
+                return false;
+            }
+            value = it->second->value_;
+            return true;
+        }
+        void remove(Key key)
+        {
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                auto it = nodeMap_.find(key);
+                if (it != nodeMap_.end())
+                {
+                    eraseEntry(it);
+                }
+                else if (!writingBack_.empty())
+                {
+                    writingBack_.erase(key);
+                }
+            }
+            notifier_.dispatch();
+        }
+        /**
+         * Removes every entry whose value was put with tag and returns how many. Work is proportional to
+         * the number of matches, done INVALIDATION_CHUNK entries per lock hold so a large tag does not
+         * stall the cache; entries put with the tag while it runs may or may not be removed.
+         */
+        size_t invalidateTag(const std::string &tag)
+        {
+            size_t removed = 0;
+            bool done = false;
+            while (!done)
+            {
+                {
+                    std::lock_guard<Mutex> lock(mutex_);
+                    auto tagged = tagIndex_.find(tag);
+                    for (size_t n = 0; tagged != tagIndex_.end() && n < INVALIDATION_CHUNK; ++n)
+                    {
+                        // erasing the last entry of the tag drops the tag itself
+                        Key key = *tagged->second.begin();
+                        eraseEntry(nodeMap_.find(key));
+                        ++removed;
+                        tagged = tagIndex_.find(tag);
+                    }
+                    done = tagged == tagIndex_.end();
+                }
+                notifier_.dispatch();
+            }
+            return removed;
+        }
+        /**
+         * Removes every entry whose std::string key starts with prefix and returns how many. There is no
+         * ordered index, so this walks the hash table, matching and erasing INVALIDATION_CHUNK buckets per
+         * lock hold. The table is first reserved for the full capacity, which a put never exceeds, so it
+         * cannot rehash under the walk and every entry cached when the call starts is seen. Entries put
+         * while it runs may or may not be removed.
+         */
+        size_t invalidatePrefix(const std::string &prefix)
+        {
+            static_assert(std::is_same<Key, std::string>::value, "invalidatePrefix needs std::string keys");
+            size_t removed = 0;
+            size_t bucket = 0;
+            size_t bucketCount = 0;
+            std::vector<Key> matches;
+            while (true)
+            {
+                {
+                    std::lock_guard<Mutex> lock(mutex_);
+                    // once reserved only loadSnapshot swaps in another table, walk that one from the start
+                    if (bucketCount != nodeMap_.bucket_count())
+                    {
+                        nodeMap_.reserve(static_cast<size_t>(std::max(capacity_, 0)));
+                        bucketCount = nodeMap_.bucket_count();
+                        bucket = 0;
+                    }
+                    size_t end = std::min(bucketCount, bucket + INVALIDATION_CHUNK);
+                    for (; bucket < end; ++bucket)
+                    {
+                        for (auto it = nodeMap_.begin(bucket); it != nodeMap_.end(bucket); ++it)
+                        {
+                            if (it->first.compare(0, prefix.size(), prefix) == 0)
+                            {
+                                matches.push_back(it->first);
+                            }
+                        }
+                    }
+                    for (const Key &key : matches)
+                    {
+                        eraseEntry(nodeMap_.find(key));
+                    }
+                }
+                removed += matches.size();
+                matches.clear();
+                notifier_.dispatch();
+                if (bucket >= bucketCount)
+                {
+                    return removed;
+                }
+            }
+        }
+        // listeners run on a thread that has just released the cache lock, never under it
+        void addRemovalListener(typename RemovalNotifier<Key, Value>::Listener listener)
+        {
+            notifier_.addListener(std::move(listener));
+        }
+        /**
+         * Switches the cache to write-behind: put only updates the cache and marks the entry dirty,
+         * the flusher writes dirty entries to its sink in batches. The flusher may be shared by several caches.
+         */
+        void enableWriteBehind(std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            writeBehind_ = std::move(writeBehind);
+        }
+        void enableWriteBehind(typename WriteBehindFlusher<Key, Value>::BatchSink sink, size_t batchSize,
+                               std::chrono::milliseconds interval)
+        {
+            enableWriteBehind(std::make_shared<WriteBehindFlusher<Key, Value>>(std::move(sink), batchSize, interval));
+        }
+        // puts and removes are appended to the log under the cache lock, so it replays in cache order
+        void enableOperationLog(std::shared_ptr<OperationLog<Key, Value>> opLog)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            opLog_ = std::move(opLog);
+        }
+        /**
+         * Keeps up to capacity keys known to be absent from the backend, each for at most ttl, in a
+         * separate LRU so they never evict present values. A put of the key clears its negative entry.
+         */
+        void enableNegativeCaching(int capacity, std::chrono::milliseconds ttl)
+        {
+            auto absent = std::make_unique<LruCache<Key, bool, NullMutex>>(capacity);
+            absent->enableExpiry(ttl);
+            std::lock_guard<Mutex> lock(mutex_);
+            absent_ = std::move(absent);
+        }
+        // records that the backend has no value for key, dropping a cached value if there is one
+        void putAbsent(Key key)
+        {
+            remove(key);
+            std::lock_guard<Mutex> lock(mutex_);
+            if (absent_)
             {
-                removeNode(it->second);
-                nodeMap_.erase(it);
+                absent_->put(key, true);
             }
         }
+        LookupResult lookup(Key key, Value &value)
+        {
+            if (get(key, value))
+            {
+                return LookupResult::Hit;
+            }
+            bool absent = false;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                bool marker = false;
+                absent = absent_ && absent_->get(key, marker);
+            }
+            return absent ? LookupResult::NegativeHit : LookupResult::Miss;
+        }
+        /**
+         * Read-through with negative caching: loader(key) returns std::optional<Value>, an empty optional
+         * meaning the backend has no such key. Only a Miss reaches the loader, concurrent misses on a key
+         * share one load. Returns false if the key is absent.
+         */
+        template <typename Loader>
+        bool lookupOrLoad(Key key, Value &value, Loader loader)
+        {
+            LookupResult result = lookup(key, value);
+            if (result != LookupResult::Miss)
+            {
+                return result == LookupResult::Hit;
+            }
+            std::optional<Value> loaded = optionalLoads_.load(key, [this, key, &loader]() -> std::optional<Value> {
+                // the previous leader may have settled the key after our miss
+                Value cached{};
+                LookupResult again = lookup(key, cached);
+                if (again != LookupResult::Miss)
+                {
+                    return again == LookupResult::Hit ? std::optional<Value>(cached) : std::nullopt;
+                }
+                std::optional<Value> fetched = loader(key);
+                if (fetched)
+                {
+                    putLoaded(key, *fetched);
+                }
+                else
+                {
+                    putAbsent(key);
+                }
+                return fetched;
+            });
+            if (loaded)
+            {
+                value = *loaded;
+            }
+            return loaded.has_value();
+        }
+        /**
+         * Bounds the cache by the summed weigher(key, value) of its entries in addition to the entry count.
+         * The weigher must return the same weight for an entry for as long as it is cached.
+         */
+        void enableWeigher(Weigher weigher, size_t maxWeight)
+        {
+            std::vector<Key> evictedKeys;
+            std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                weigher_ = std::move(weigher);
+                maxWeight_ = maxWeight;
+                totalWeight_ = 0;
+                for (auto &pair : nodeMap_)
+                {
+                    totalWeight_ += weigh(pair.second->key_, pair.second->value_);
+                }
+                evictOverweight();
+                writeBehind = writeBehind_;
+                evictedKeys.swap(evictedKeys_);
+            }
+            writeBackEvicted(writeBehind, evictedKeys);
+            notifier_.dispatch();
+        }
+        size_t totalWeight()
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            return totalWeight_;
+        }
+        size_t size()
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            return nodeMap_.size();
+        }
+        /**
+         * A hit moves its entry to the most recent end at most once per interval (puts always do), so hot
+         * keys stop paying for the list splice. With std::shared_mutex such hits run under a shared lock.
+         * An entry's recency is then up to interval stale, which can cost some hit rate.
+         */
+        void enablePromotionThrottle(std::chrono::milliseconds interval)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            auto now = Clock::now();
+            for (auto &pair : nodeMap_)
+            {
+                pair.second->promotedAt_ = now;
+            }
+            promoteInterval_.store(interval, std::memory_order_relaxed);
+        }
+        /**
+         * InnoDB-style midpoint insertion: the list is split into a young sublist at the most recent end
+         * and an old one of oldPercent (clamped to 5..95) of the capacity at the eviction end. New entries
+         * go to the head of the old sublist, so a scan or a burst of one-off keys only cycles through the
+         * old part. An old entry joins the young head when it is accessed (get or put) again at least
+         * oldBlocksTime after its insertion; earlier accesses leave it where it is. When the young sublist
+         * overflows, its least recent entry becomes the head of the old one. All of it is O(1) per access,
+         * with no history beyond one flag per entry. Entries present when this is enabled, or loaded from
+         * a snapshot later, start out old.
+         */
+        void enableMidpointInsertion(int oldPercent = 37,
+                                     std::chrono::milliseconds oldBlocksTime = std::chrono::milliseconds(0))
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            oldPercent = std::min(95, std::max(5, oldPercent));
+            youngCapacity_ = static_cast<size_t>(std::max(capacity_, 0)) * (100 - oldPercent) / 100;
+            oldBlocksTime_ = oldBlocksTime;
+            if (!midpoint_)
+            {
+                midpoint_ = std::make_shared<LruNodeType>(Key(), Value());
+                insertBefore(midpoint_, dummyTail_);
+            }
+            while (youngCount_ > youngCapacity_)
+            {
+                demoteLeastRecentYoung();
+            }
+        }
+        // entries older than expireAfter (since their last put, or since this call) are treated as misses
+        void enableExpiry(std::chrono::milliseconds expireAfter)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            startExpiry(expireAfter);
+        }
+        /**
+         * A get on an entry older than refreshAfter but younger than expireAfter returns the current value
+         * and schedules a single reloader(key) call on the executor. The destructor waits for reloads in
+         * flight, so the executor must either outlive the cache or drain its tasks before the cache goes.
+         */
+        void enableRefreshAhead(std::chrono::milliseconds refreshAfter, std::chrono::milliseconds expireAfter,
+                                Reloader reloader, CacheExecutor &executor)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            refreshAfter_ = refreshAfter;
+            startExpiry(expireAfter);
+            reloader_ = std::move(reloader);
+            executor_ = &executor;
+        }
+        /**
+         * Moves housekeeping off the request path onto scheduler: once a put fills the cache to
+         * highPercent of its capacity, a background task evicts least recent entries down to lowPercent,
+         * so puts find free room instead of evicting (and writing back) inline. With expiry enabled the
+         * task also sweeps expired entries out every scheduler interval. Each slice holds the lock for at
+         * most MAINTENANCE_CHUNK entries or buckets. A put at full capacity still evicts inline, and the
+         * cache then mostly holds between lowPercent and highPercent of its capacity. The scheduler must
+         * outlive the cache.
+         */
+        void enableMaintenance(MaintenanceScheduler &scheduler, int lowPercent = 90, int highPercent = 95)
+        {
+            static_assert(!std::is_same<Mutex, NullMutex>::value, "maintenance runs on another thread");
+            disableMaintenance();
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                highWatermark_ = std::max<size_t>(1, static_cast<size_t>(capacity_) * std::min(highPercent, 100) / 100);
+                lowWatermark_ = std::min(highWatermark_ - 1, static_cast<size_t>(capacity_) * std::max(lowPercent, 0) / 100);
+                maintenance_ = &scheduler;
+            }
+            maintenanceTask_ = scheduler.add([this]() { return maintain(); });
+        }
+        // back to inline housekeeping; waits for a running slice to finish
+        void disableMaintenance()
+        {
+            MaintenanceScheduler *scheduler;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                scheduler = maintenance_;
+                maintenance_ = nullptr;
+            }
+            if (scheduler)
+            {
+                scheduler->remove(maintenanceTask_);
+            }
+        }
+        // writes every dirty entry to the sink now
+        void flush()
+        {
+            std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                writeBehind = writeBehind_;
+            }
+            if (writeBehind)
+            {
+                writeBehind->flush();
+            }
+        }
+        /**
+         * Calls visitor(key, value) for every cached entry, a chunk of buckets per lock hold and outside
+         * the lock (see scanChunked for what is guaranteed). Recency is not touched, expired entries are
+         * skipped.
+         */
+        template <typename Visitor>
+        size_t forEach(Visitor visitor)
+        {
+            return scanChunked<Key, Value>(mutex_, nodeMap_, [this](const NodePtr &node, Value &value) {
+                if (expireAfter_ > Clock::duration::zero() && Clock::now() - node->loadTime_ >= expireAfter_)
+                {
+                    return false;
+                }
+                value = node->value_;
+                return true;
+            }, visitor);
+        }
+        // payload: uint64 count, then count (key, value) pairs from least to most recent
+        bool saveSnapshot(const std::string &path)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            return writeSnapshot(path);
+        }
+        /**
+         * Replaces the contents with a snapshot, keeping its recency order. The list is linked straight
+         * from the mapped file and swapped in under the lock; a snapshot larger than the capacity loses its
+         * least recent entries. On failure the cache is left untouched.
+         */
+        bool loadSnapshot(const std::string &path)
+        {
+            SnapshotReader reader;
+            uint64_t count = 0;
+            if (!reader.open(path, SnapshotPolicy::Lru) || !reader.read(count))
+            {
+                return false;
+            }
+            uint64_t skip = count > static_cast<uint64_t>(capacity_) ? count - capacity_ : 0;
+            NodeMap nodeMap;
+            nodeMap.reserve(count - skip);
+            NodePtr head = std::make_shared<LruNodeType>(Key(), Value());
+            NodePtr tail = head;
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                Key key{};
+                Value value{};
+                if (!reader.read(key) || !reader.read(value))
+                {
+                    releaseChain(head);
+                    return false;
+                }
+                if (i < skip)
+                {
+                    continue;
+                }
+                // a key written twice (only a damaged or hand-made snapshot has one) keeps its later value
+                // and position, a second node would be unreachable through the map
+                auto existing = nodeMap.find(key);
+                if (existing != nodeMap.end())
+                {
+                    NodePtr node = existing->second;
+                    node->setValue(value);
+                    if (node != tail)
+                    {
+                        NodePtr prev = node->prev_.lock();
+                        prev->next_ = node->next_;
+                        node->next_->prev_ = prev;
+                        node->next_.reset();
+                        node->prev_ = tail;
+                        tail->next_ = node;
+                        tail = node;
+                    }
+                    continue;
+                }
+                NodePtr node = std::make_shared<LruNodeType>(key, value);
+                node->prev_ = tail;
+                tail->next_ = node;
+                tail = node;
+                nodeMap[key] = node;
+            }
+            if (!reader.atEnd())
+            {
+                releaseChain(head);
+                return false;
+            }
+            NodePtr oldChain;
+            std::vector<Key> evictedKeys;
+            std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                // the midpoint must not be released with the old chain, it comes back at the most recent end
+                if (midpoint_)
+                {
+                    removeNode(midpoint_);
+                }
+                // keep the old sentinels, only their links move over to the loaded chain
+                if (dummyHead_->next_ != dummyTail_)
+                {
+                    oldChain = dummyHead_->next_;
+                    dummyTail_->prev_.lock()->next_ = nullptr;
+                }
+                if (tail == head)
+                {
+                    dummyHead_->next_ = dummyTail_;
+                    dummyTail_->prev_ = dummyHead_;
+                }
+                else
+                {
+                    dummyHead_->next_ = head->next_;
+                    dummyHead_->next_->prev_ = dummyHead_;
+                    tail->next_ = dummyTail_;
+                    dummyTail_->prev_ = tail;
+                }
+                if (midpoint_)
+                {
+                    insertBefore(midpoint_, dummyTail_);
+                    youngCount_ = 0;
+                }
+                totalWeight_ = 0;
+                for (auto &pair : nodeMap)
+                {
+                    touchLoadTime(pair.second);
+                    totalWeight_ += weigh(pair.second->key_, pair.second->value_);
+                }
+                nodeMap_.swap(nodeMap);
+                // snapshots carry no tags
+                tagIndex_.clear();
+                evictOverweight();
+                writeBehind = writeBehind_;
+                evictedKeys.swap(evictedKeys_);
+            }
+            // the replaced entries are released outside the lock
+            releaseChain(oldChain);
+            writeBackEvicted(writeBehind, evictedKeys);
+            notifier_.dispatch();
+            return true;
+        }
 
     private:
+        friend class BackgroundSnapshot;
+        static constexpr size_t INVALIDATION_CHUNK = 256;
+        static constexpr size_t MAINTENANCE_CHUNK = 256;
+        // a NullMutex cache gains nothing from a separate shared pass
+        static constexpr bool SHARED_HITS = HasSharedLock<Mutex>::value && !std::is_same<Mutex, NullMutex>::value;
+
+        // caller holds mutex_, or is a forked child that owns a private copy of the cache
+        bool writeSnapshot(const std::string &path)
+        {
+            SnapshotWriter writer(SnapshotPolicy::Lru);
+            if (!writer.open(path))
+            {
+                return false;
+            }
+            writer.write(static_cast<uint64_t>(nodeMap_.size()));
+            for (NodePtr node = dummyHead_->next_; node != dummyTail_; node = node->next_)
+            {
+                if (node == midpoint_)
+                {
+                    continue;
+                }
+                writer.write(node->key_);
+                writer.write(node->value_);
+            }
+            return writer.commit();
+        }
+        /**
+         * Nodes own their successor, so dropping the head of a long list would free it recursively and
+         * overflow the stack; unlink it front to back instead.
+         */
+        static void releaseChain(NodePtr node)
+        {
+            while (node)
+            {
+                NodePtr next = std::move(node->next_);
+                node = std::move(next);
+            }
+        }
         void initializeList()
         {
             dummyHead_ = std::make_shared<LruNodeType>(Key(), Value());
@@ -118,12 +739,78 @@ namespace mwm1cCache
             dummyHead_->next_ = dummyTail_;
             dummyTail_->prev_ = dummyHead_;
         }
+        void putEntry(Key key, Value value, std::vector<std::string> tags, bool dirty)
+        {
+            if (capacity_ <= 0)
+                return;
+            std::vector<Key> evictedKeys;
+            std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                auto it = nodeMap_.find(key);
+                NodePtr node;
+                if (it != nodeMap_.end())
+                {
+                    /**
+                     * If the key is in the current container, update the value and call the get method,
+                     * indicating that the data has just been accessed.
+                     */
+                    node = it->second;
+                    updateExistingNode(node, value);
+                }
+                else
+                {
+                    node = addNewNode(key, value);
+                }
+                if (!node->tags_.empty() || !tags.empty())
+                {
+                    retag(node, std::move(tags));
+                }
+                evictOverweight();
+                // the key exists now, forget that it was absent
+                if (absent_)
+                {
+                    absent_->remove(key);
+                }
+                if (opLog_)
+                {
+                    opLog_->appendPut(key, value);
+                }
+                if (maintenance_ && nodeMap_.size() >= highWatermark_)
+                {
+                    requestMaintenance();
+                }
+                if (writeBehind_)
+                {
+                    if (dirty)
+                    {
+                        writeBehind_->markDirty(key, value);
+                    }
+                    evictedKeys.swap(evictedKeys_);
+                    writeBehind = writeBehind_;
+                }
+            }
+            // a dirty victim is written back before the evicting put returns, outside the cache lock
+            writeBackEvicted(writeBehind, evictedKeys);
+            notifier_.dispatch();
+        }
         void updateExistingNode(NodePtr node, const Value &value)
         {
+            notifier_.enqueue(node->key_, node->value_, RemovalCause::Replaced);
+            totalWeight_ += weigh(node->key_, value) - weigh(node->key_, node->value_);
             node->setValue(value);
+            touchLoadTime(node);
+            touchPromotedAt(node);
             moveToMostRecent(node);
         }
-        void addNewNode(const Key &key, const Value &value)
+        void touchPromotedAt(NodePtr node)
+        {
+            if (promoteInterval_.load(std::memory_order_relaxed) > Clock::duration::zero())
+            {
+                node->promotedAt_ = Clock::now();
+            }
+        }
+        NodePtr addNewNode(const Key &key, const Value &value)
         {
             if (nodeMap_.size() >= capacity_)
             {
@@ -131,13 +818,273 @@ namespace mwm1cCache
             }
             // NodePtr newNode = std::make_shared<NodePtr>(Key(key), Value(value));
             NodePtr newNode = std::make_shared<LruNodeType>(key, value);
-            insertNode(newNode);
+            totalWeight_ += weigh(key, value);
+            touchLoadTime(newNode);
+            touchPromotedAt(newNode);
+            if (midpoint_)
+            {
+                if (oldBlocksTime_ > Clock::duration::zero())
+                {
+                    newNode->insertedAt_ = Clock::now();
+                }
+                insertBefore(newNode, midpoint_);
+            }
+            else
+            {
+                insertNode(newNode);
+            }
             nodeMap_[key] = newNode;
+            return newNode;
+        }
+        // caller holds mutex_ and dispatches afterwards
+        void expireEntry(typename NodeMap::iterator it)
+        {
+            NodePtr node = it->second;
+            totalWeight_ -= weigh(node->key_, node->value_);
+            untag(node);
+            unlinkEntry(node);
+            nodeMap_.erase(it);
+            notifier_.enqueue(node->key_, node->value_, RemovalCause::Expired);
+            // logged like a remove, so a replay does not bring the entry back
+            if (opLog_)
+            {
+                opLog_->appendRemove(node->key_);
+            }
         }
+        // explicit removal of a cached entry, caller holds mutex_ and dispatches afterwards
+        void eraseEntry(typename NodeMap::iterator it)
+        {
+            NodePtr node = it->second;
+            notifier_.enqueue(node->key_, node->value_, RemovalCause::Explicit);
+            // an older evicted value must not outlive the removal either
+            if (!writingBack_.empty())
+            {
+                writingBack_.erase(node->key_);
+            }
+            totalWeight_ -= weigh(node->key_, node->value_);
+            untag(node);
+            unlinkEntry(node);
+            nodeMap_.erase(it);
+            if (opLog_)
+            {
+                opLog_->appendRemove(node->key_);
+            }
+        }
+        void retag(NodePtr node, std::vector<std::string> tags)
+        {
+            untag(node);
+            node->tags_ = std::move(tags);
+            for (const std::string &tag : node->tags_)
+            {
+                tagIndex_[tag].insert(node->key_);
+            }
+        }
+        void untag(NodePtr node)
+        {
+            for (const std::string &tag : node->tags_)
+            {
+                auto tagged = tagIndex_.find(tag);
+                if (tagged != tagIndex_.end())
+                {
+                    tagged->second.erase(node->key_);
+                    if (tagged->second.empty())
+                    {
+                        tagIndex_.erase(tagged);
+                    }
+                }
+            }
+            node->tags_.clear();
+        }
+        size_t weigh(const Key &key, const Value &value) const
+        {
+            return weigher_ ? weigher_(key, value) : 0;
+        }
+        // the most recent entry stays even if it alone is over the limit
+        void evictOverweight()
+        {
+            while (weigher_ && totalWeight_ > maxWeight_ && nodeMap_.size() > 1)
+            {
+                evictLeastRecent();
+            }
+        }
+        /**
+         * Shared-lock half of a throttled get: answers misses and hits that need no promotion, expiry or
+         * refresh, and returns nullopt for everything the exclusive path has to handle.
+         */
+        std::optional<bool> getUnpromoted(const Key &key, Value &value)
+        {
+            ReadLock<Mutex> lock(mutex_);
+            auto it = nodeMap_.find(key);
+            if (it == nodeMap_.end())
+            {
+                return findWritingBack(key, value);
+            }
+            const NodePtr &node = it->second;
+            auto now = Clock::now();
+            if (now - node->promotedAt_ >= promoteInterval_.load(std::memory_order_relaxed))
+            {
+                return std::nullopt;
+            }
+            if (expireAfter_ > Clock::duration::zero() &&
+                now - node->loadTime_ >= (reloader_ ? std::min(refreshAfter_, expireAfter_) : expireAfter_))
+            {
+                return std::nullopt;
+            }
+            value = node->value_;
+            return true;
+        }
+        // moveToMostRecent for hits, skipped for entries promoted less than promoteInterval_ ago
+        void promote(NodePtr node)
+        {
+            Clock::duration interval = promoteInterval_.load(std::memory_order_relaxed);
+            if (interval > Clock::duration::zero())
+            {
+                auto now = Clock::now();
+                if (now - node->promotedAt_ < interval)
+                {
+                    return;
+                }
+                node->promotedAt_ = now;
+            }
+            moveToMostRecent(node);
+        }
+        /**
+         * Load times are only kept while expiry is on, so entries cached before it is switched on have none;
+         * they start their TTL now instead of all expiring (or refreshing) at once.
+         */
+        void startExpiry(std::chrono::milliseconds expireAfter)
+        {
+            bool wasOff = expireAfter_ <= Clock::duration::zero();
+            expireAfter_ = expireAfter;
+            if (wasOff)
+            {
+                for (auto &pair : nodeMap_)
+                {
+                    touchLoadTime(pair.second);
+                }
+            }
+        }
+        void touchLoadTime(NodePtr node)
+        {
+            if (expireAfter_ > Clock::duration::zero())
+            {
+                node->loadTime_ = Clock::now();
+                node->refreshing_ = false;
+            }
+        }
+        void scheduleRefresh(const Key &key)
+        {
+            {
+                std::lock_guard<std::mutex> lock(refreshMutex_);
+                if (closing_)
+                {
+                    return;
+                }
+                ++refreshesInFlight_;
+            }
+            executor_->execute([this, key]() {
+                Value value{};
+                bool loaded = false;
+                try
+                {
+                    value = reloader_(key);
+                    loaded = true;
+                }
+                catch (...)
+                {
+                }
+                completeRefresh(key, value, loaded);
+                std::lock_guard<std::mutex> lock(refreshMutex_);
+                if (--refreshesInFlight_ == 0)
+                {
+                    refreshDone_.notify_all();
+                }
+            });
+        }
+        // stops scheduling reloads and waits until none references the cache any more
+        void waitForRefreshes()
+        {
+            std::unique_lock<std::mutex> lock(refreshMutex_);
+            closing_ = true;
+            refreshDone_.wait(lock, [this]() { return refreshesInFlight_ == 0; });
+        }
+        /**
+         * A reload only replaces the value of an entry that is still cached. It is neither a put
+         * (no write-behind, no recency move; only the operation log records it like one) nor a
+         * reinsertion of a key evicted meanwhile.
+         */
+        void completeRefresh(const Key &key, const Value &value, bool loaded)
+        {
+            std::vector<Key> evictedKeys;
+            std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                auto it = nodeMap_.find(key);
+                if (it == nodeMap_.end())
+                {
+                    return;
+                }
+                if (loaded)
+                {
+                    notifier_.enqueue(it->second->key_, it->second->value_, RemovalCause::Replaced);
+                    totalWeight_ += weigh(key, value) - weigh(key, it->second->value_);
+                    it->second->setValue(value);
+                    touchLoadTime(it->second);
+                    // logged like a put, so a replay restores the reloaded value and not the stale one
+                    if (opLog_)
+                    {
+                        opLog_->appendPut(key, value);
+                    }
+                    evictOverweight();
+                    writeBehind = writeBehind_;
+                    evictedKeys.swap(evictedKeys_);
+                }
+                else
+                {
+                    // failed reload, let the next stale hit try again
+                    it->second->refreshing_ = false;
+                }
+            }
+            writeBackEvicted(writeBehind, evictedKeys);
+            notifier_.dispatch();
+        }
+        // with midpoint insertion, an old entry only moves once it is past oldBlocksTime_
         void moveToMostRecent(NodePtr node)
         {
+            if (midpoint_ && !node->young_)
+            {
+                if (oldBlocksTime_ > Clock::duration::zero() && Clock::now() - node->insertedAt_ < oldBlocksTime_)
+                {
+                    return;
+                }
+                node->young_ = true;
+                ++youngCount_;
+            }
             removeNode(node);
             insertNode(node);
+            if (youngCount_ > youngCapacity_)
+            {
+                demoteLeastRecentYoung();
+            }
+        }
+        // moves the midpoint over the least recent young entry, which makes it the head of the old sublist
+        void demoteLeastRecentYoung()
+        {
+            NodePtr node = midpoint_->next_;
+            removeNode(midpoint_);
+            insertBefore(midpoint_, node->next_);
+            node->young_ = false;
+            --youngCount_;
+        }
+        // removeNode for entries leaving the cache
+        void unlinkEntry(NodePtr node)
+        {
+            if (node->young_)
+            {
+                node->young_ = false;
+                --youngCount_;
+            }
+            removeNode(node);
         }
         void removeNode(NodePtr node)
         {
@@ -152,22 +1099,193 @@ namespace mwm1cCache
         // insert node to tail of linkedlist
         void insertNode(NodePtr node)
         {
-            node->next_ = dummyTail_;
-            node->prev_ = dummyTail_->prev_;
-            dummyTail_->prev_.lock()->next_ = node;
-            dummyTail_->prev_ = node;
+            insertBefore(node, dummyTail_);
+        }
+        void insertBefore(NodePtr node, NodePtr next)
+        {
+            node->next_ = next;
+            node->prev_ = next->prev_;
+            next->prev_.lock()->next_ = node;
+            next->prev_ = node;
+        }
+        // caller holds mutex_; wakes the scheduler once per slice, it never holds its lock while running one
+        void requestMaintenance()
+        {
+            if (!maintenanceWoken_.exchange(true, std::memory_order_relaxed))
+            {
+                maintenance_->wake();
+            }
+        }
+        /**
+         * One slice of background housekeeping, returns whether there is more. Eviction ahead starts at
+         * the high watermark and runs until the low one; the expiry sweep walks the buckets once per
+         * scheduler round and restarts if a rehash moved the keys.
+         */
+        bool maintain()
+        {
+            std::vector<Key> evictedKeys;
+            std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind;
+            bool more = false;
+            {
+                std::lock_guard<Mutex> lock(mutex_);
+                maintenanceWoken_.store(false, std::memory_order_relaxed);
+                size_t work = 0;
+                evictingAhead_ = evictingAhead_ || nodeMap_.size() >= highWatermark_;
+                while (evictingAhead_ && nodeMap_.size() > lowWatermark_ && work < MAINTENANCE_CHUNK)
+                {
+                    evictLeastRecent();
+                    ++work;
+                }
+                evictingAhead_ = evictingAhead_ && nodeMap_.size() > lowWatermark_;
+                if (expireAfter_ > Clock::duration::zero() && work < MAINTENANCE_CHUNK)
+                {
+                    sweepExpired(MAINTENANCE_CHUNK - work);
+                }
+                more = evictingAhead_ || sweepBucket_ != 0;
+                writeBehind = writeBehind_;
+                evictedKeys.swap(evictedKeys_);
+            }
+            writeBackEvicted(writeBehind, evictedKeys);
+            notifier_.dispatch();
+            return more;
+        }
+        // caller holds mutex_; sweeps up to buckets buckets from sweepBucket_, back to 0 at the end of the table
+        void sweepExpired(size_t buckets)
+        {
+            if (sweepBucket_ >= nodeMap_.bucket_count())
+            {
+                sweepBucket_ = 0;
+            }
+            auto now = Clock::now();
+            std::vector<Key> expired;
+            size_t end = std::min(nodeMap_.bucket_count(), sweepBucket_ + buckets);
+            for (; sweepBucket_ < end; ++sweepBucket_)
+            {
+                for (auto it = nodeMap_.begin(sweepBucket_); it != nodeMap_.end(sweepBucket_); ++it)
+                {
+                    if (now - it->second->loadTime_ >= expireAfter_)
+                    {
+                        expired.push_back(it->first);
+                    }
+                }
+            }
+            for (const Key &key : expired)
+            {
+                expireEntry(nodeMap_.find(key));
+            }
+            if (sweepBucket_ >= nodeMap_.bucket_count())
+            {
+                sweepBucket_ = 0;
+            }
         }
         void evictLeastRecent()
         {
             NodePtr leastRecent = dummyHead_->next_;
-            removeNode(leastRecent);
+            // the old sublist is empty, evict from the young one
+            if (leastRecent == midpoint_)
+            {
+                leastRecent = leastRecent->next_;
+            }
+            unlinkEntry(leastRecent);
             nodeMap_.erase(leastRecent->getKey());
+            totalWeight_ -= weigh(leastRecent->key_, leastRecent->value_);
+            untag(leastRecent);
+            notifier_.enqueue(leastRecent->key_, leastRecent->value_, RemovalCause::Size);
+            if (writeBehind_)
+            {
+                evictedKeys_.push_back(leastRecent->getKey());
+                // readers keep seeing the value until it is written back, a miss would load a stale one
+                auto &pending = writingBack_[leastRecent->key_];
+                pending.first = leastRecent->value_;
+                ++pending.second;
+            }
+        }
+        // caller holds mutex_ (shared is enough)
+        bool findWritingBack(const Key &key, Value &value) const
+        {
+            if (writingBack_.empty())
+            {
+                return false;
+            }
+            auto it = writingBack_.find(key);
+            if (it == writingBack_.end())
+            {
+                return false;
+            }
+            value = it->second.first;
+            return true;
+        }
+        /**
+         * Every locked section that can evict takes the victims out of evictedKeys_ and hands them here
+         * after unlocking, so no dirty victim waits for the next put to be written back.
+         */
+        void writeBackEvicted(const std::shared_ptr<WriteBehindFlusher<Key, Value>> &writeBehind,
+                              const std::vector<Key> &evictedKeys)
+        {
+            if (writeBehind && !evictedKeys.empty())
+            {
+                writeBehind->flushKeys(evictedKeys);
+                finishWriteBack(evictedKeys);
+            }
+        }
+        // called once flushKeys() has returned for victims taken out of evictedKeys_
+        void finishWriteBack(const std::vector<Key> &keys)
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            for (const Key &key : keys)
+            {
+                auto it = writingBack_.find(key);
+                if (it != writingBack_.end() && --it->second.second == 0)
+                {
+                    writingBack_.erase(it);
+                }
+            }
         }
         int capacity_;
+        Weigher weigher_;
+        size_t maxWeight_;
+        size_t totalWeight_;
         NodeMap nodeMap_;
-        std::mutex mutex_;
+        Mutex mutex_;
         NodePtr dummyHead_;
         NodePtr dummyTail_;
+        std::shared_ptr<WriteBehindFlusher<Key, Value>> writeBehind_;
+        Clock::duration expireAfter_;
+        Clock::duration refreshAfter_;
+        Reloader reloader_;
+        CacheExecutor *executor_;
+        // reload tasks capture this, the destructor waits for them
+        std::mutex refreshMutex_;
+        std::condition_variable refreshDone_;
+        size_t refreshesInFlight_ = 0;
+        bool closing_ = false;
+        // written under the exclusive lock, read before taking it to pick the shared path
+        std::atomic<Clock::duration> promoteInterval_;
+        RemovalNotifier<Key, Value> notifier_;
+        std::shared_ptr<OperationLog<Key, Value>> opLog_;
+        // only touched under mutex_
+        std::unique_ptr<LruCache<Key, bool, NullMutex>> absent_;
+        SingleFlight<Key, std::optional<Value>> optionalLoads_;
+        // tag -> keys whose current value carries it
+        std::unordered_map<std::string, std::unordered_set<Key>> tagIndex_;
+        // victims of the current put (or maintenance slice) that still need a write-back
+        std::vector<Key> evictedKeys_;
+        // evicted values until their write-back is done, with the number of evictions still pending
+        std::unordered_map<Key, std::pair<Value, size_t>> writingBack_;
+        MaintenanceScheduler *maintenance_;
+        MaintenanceScheduler::TaskId maintenanceTask_;
+        size_t lowWatermark_;
+        size_t highWatermark_;
+        // set at the high watermark, cleared once the low one is reached
+        bool evictingAhead_;
+        size_t sweepBucket_;
+        // a wake-up is pending, saves the scheduler lock on every put above the high watermark
+        std::atomic<bool> maintenanceWoken_;
+        // sentinel between the old sublist (towards dummyHead_) and the young one, null without midpoint insertion
+        NodePtr midpoint_;
+        size_t youngCapacity_;
+        size_t youngCount_;
+        Clock::duration oldBlocksTime_;
     };
 
     // version 2
@@ -176,11 +1294,11 @@ namespace mwm1cCache
     {
     public:
         LruKCache(int cap, int historyCap, int k)
-            : LruCache<Key, Value>(cap), historyList_(std::make_unique<LruCache<Key, size_t>>(historyCap)), k_(k) {}
-        Value get(Key key)
+            : LruCache<Key, Value>(cap), historyList_(std::make_unique<LruCache<Key, size_t, NullMutex>>(historyCap)), k_(k) {}
+        bool get(Key key, Value &value) override
         {
-            Value value{};
             bool inMainCache = LruCache<Key, Value>::get(key, value);
+            std::lock_guard<std::mutex> lock(historyMutex_);
             // fetch and update access history count
             size_t historyCount = historyList_->get(key);
             ++historyCount;
@@ -188,7 +1306,7 @@ namespace mwm1cCache
             // return directly if data in main-cache
             if (inMainCache)
             {
-                return value;
+                return true;
             }
             // if data isn't in main-cache, but access reach to k
             if (historyCount >= k_)
@@ -203,13 +1321,20 @@ namespace mwm1cCache
                     historyValueMap_.erase(it);
                     // move to main-cache
                     LruCache<Key, Value>::put(key, storedValue);
-                    return storedValue;
+                    value = storedValue;
+                    return true;
                 }
                 // dont have history record, return default value;
             }
+            return false;
+        }
+        Value get(Key key) override
+        {
+            Value value{};
+            get(key, value);
             return value;
         }
-        void put(Key key, Value value)
+        void put(Key key, Value value) override
         {
             // check out if value in main-cache
             Value existingValue{};
@@ -219,6 +1344,7 @@ namespace mwm1cCache
                 LruCache<Key, Value>::put(key, value);
                 return;
             }
+            std::lock_guard<std::mutex> lock(historyMutex_);
             // fetch and update history record
             size_t historyCount = historyList_->get(key);
             ++historyCount;
@@ -233,18 +1359,38 @@ namespace mwm1cCache
                 LruCache<Key, Value>::put(key, value);
             }
         }
+        /**
+         * Read-through fill after a get() miss. That get already counted the access, so unlike put
+         * this does not add to the history: the value waits in the history map until the k-th get.
+         */
+        void putLoaded(Key key, Value value)
+        {
+            std::lock_guard<std::mutex> lock(historyMutex_);
+            size_t historyCount = 0;
+            historyList_->peek(key, historyCount);
+            if (historyCount >= static_cast<size_t>(k_))
+            {
+                historyList_->remove(key);
+                historyValueMap_.erase(key);
+                LruCache<Key, Value>::putLoaded(key, value);
+                return;
+            }
+            historyValueMap_[key] = value;
+        }
 
     private:
         // criteria for entering the cache queue
         int k_;
+        // guards the history list and map; taken after the main cache lock is released, held across a promotion
+        std::mutex historyMutex_;
         // Access Data History (value represents the number of visits)
-        std::unique_ptr<LruCache<Key, size_t>> historyList_;
+        std::unique_ptr<LruCache<Key, size_t, NullMutex>> historyList_;
         // Data values that have not reached k accesses
         std::unordered_map<Key, Value> historyValueMap_;
     };
 
     // version 3
-    template <typename Key, typename Value>
+    template <typename Key, typename Value, typename Mutex = std::mutex>
     class HashLruCaches
     {
     public:
@@ -252,9 +1398,10 @@ namespace mwm1cCache
             : capacity_(cap), sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency())
         {
             size_t sliceSize = std::ceil(cap / static_cast<double>(sliceNum_));
-            for (int i = 0; i < sliceNum; ++i)
+            for (int i = 0; i < sliceNum_; ++i)
             {
-                lruSliceCaches.emplace_back(new LruCache<Key, Value>(sliceNum_));
+                lruSliceCaches.emplace_back(new LruCache<Key, Value, Mutex>(sliceSize));
+                sliceLoading_.emplace_back(new LoadingCache<Key, Value, LruCache<Key, Value, Mutex>>(*lruSliceCaches.back()));
             }
         }
         void put(Key key, Value value)
@@ -273,6 +1420,220 @@ namespace mwm1cCache
             get(key, value);
             return value;
         }
+        void remove(Key key)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            lruSliceCaches[sliceIndex]->remove(key);
+        }
+        bool peek(const Key &key, Value &value)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return lruSliceCaches[sliceIndex]->peek(key, value);
+        }
+        void put(Key key, Value value, std::vector<std::string> tags)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            lruSliceCaches[sliceIndex]->put(key, value, std::move(tags));
+        }
+        void putLoaded(Key key, Value value)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            lruSliceCaches[sliceIndex]->putLoaded(key, value);
+        }
+        // slices one after another; scan() is the parallel variant
+        template <typename Visitor>
+        size_t forEach(Visitor visitor)
+        {
+            return scanSlices(lruSliceCaches, 1, std::move(visitor));
+        }
+        // walks up to threads slices at a time, so the visitor must be thread-safe
+        template <typename Visitor>
+        size_t scan(Visitor visitor, int threads)
+        {
+            return scanSlices(lruSliceCaches, threads, std::move(visitor));
+        }
+        // slices are invalidated one after another, each holding only its own lock
+        size_t invalidateTag(const std::string &tag)
+        {
+            size_t removed = 0;
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                removed += lruSliceCache->invalidateTag(tag);
+            }
+            return removed;
+        }
+        // slice by slice; an entry cached when the call starts is still there when its slice is walked
+        size_t invalidatePrefix(const std::string &prefix)
+        {
+            size_t removed = 0;
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                removed += lruSliceCache->invalidatePrefix(prefix);
+            }
+            return removed;
+        }
+        template <typename Loader>
+        Value getOrLoad(Key key, Loader loader)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return sliceLoading_[sliceIndex]->getOrLoad(key, loader);
+        }
+        // all slices share one flusher, so a batch can carry dirty entries from several slices
+        void enableWriteBehind(typename WriteBehindFlusher<Key, Value>::BatchSink sink, size_t batchSize,
+                               std::chrono::milliseconds interval)
+        {
+            auto writeBehind = std::make_shared<WriteBehindFlusher<Key, Value>>(std::move(sink), batchSize, interval);
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableWriteBehind(writeBehind);
+            }
+        }
+        void flush()
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->flush();
+            }
+        }
+        void addRemovalListener(typename RemovalNotifier<Key, Value>::Listener listener)
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->addRemovalListener(listener);
+            }
+        }
+        // foreground dump, one "<path>.<slice index>" file per slice
+        bool saveSnapshot(const std::string &path)
+        {
+            return persistence_.saveSnapshot(lruSliceCaches, path);
+        }
+        // slices are matched to files by index, so the slice count must be the one the snapshot was taken with
+        bool loadSnapshot(const std::string &path)
+        {
+            return persistence_.loadSnapshot(lruSliceCaches, path);
+        }
+        /**
+         * Starts a fork()-based dump of all slices and returns right away; traffic is only blocked while
+         * the process forks. Collect the result with waitSnapshot() before starting the next one.
+         */
+        bool saveSnapshotInBackground(const std::string &path)
+        {
+            return persistence_.saveSnapshotInBackground(lruSliceCaches, path);
+        }
+        bool snapshotRunning()
+        {
+            return persistence_.snapshotRunning();
+        }
+        bool waitSnapshot()
+        {
+            return persistence_.waitSnapshot();
+        }
+        /**
+         * Logs every put/remove per slice and syncs all logs every commitInterval. Snapshots saved to the
+         * same path truncate the logs, so recover(path) only replays what happened after the last one.
+         */
+        void enableOperationLog(const std::string &path, std::chrono::milliseconds commitInterval)
+        {
+            persistence_.enableOperationLog(lruSliceCaches, path, commitInterval);
+        }
+        // rebuilds every slice in parallel from its snapshot and log, call before enableOperationLog()
+        void recover(const std::string &path)
+        {
+            persistence_.recover(lruSliceCaches, path, [](LruCache<Key, Value, Mutex> &slice, LogOp op, const Key &key, const Value &value) {
+                if (op == LogOp::Put)
+                {
+                    slice.put(key, value);
+                }
+                else if (op == LogOp::Remove)
+                {
+                    slice.remove(key);
+                }
+            });
+        }
+        // each slice gets an equal share of the negative capacity
+        void enableNegativeCaching(int capacity, std::chrono::milliseconds ttl)
+        {
+            int sliceCapacity = std::max(1, capacity / sliceNum_);
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableNegativeCaching(sliceCapacity, ttl);
+            }
+        }
+        void putAbsent(Key key)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            lruSliceCaches[sliceIndex]->putAbsent(key);
+        }
+        LookupResult lookup(Key key, Value &value)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return lruSliceCaches[sliceIndex]->lookup(key, value);
+        }
+        template <typename Loader>
+        bool lookupOrLoad(Key key, Value &value, Loader loader)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return lruSliceCaches[sliceIndex]->lookupOrLoad(key, value, loader);
+        }
+        // each slice gets an equal share of maxWeight
+        void enableWeigher(typename LruCache<Key, Value, Mutex>::Weigher weigher, size_t maxWeight)
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableWeigher(weigher, maxWeight / lruSliceCaches.size());
+            }
+        }
+        // every slice gets its own task on the shared scheduler
+        void enableMaintenance(MaintenanceScheduler &scheduler, int lowPercent = 90, int highPercent = 95)
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableMaintenance(scheduler, lowPercent, highPercent);
+            }
+        }
+        void disableMaintenance()
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->disableMaintenance();
+            }
+        }
+        void enableMidpointInsertion(int oldPercent = 37,
+                                     std::chrono::milliseconds oldBlocksTime = std::chrono::milliseconds(0))
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableMidpointInsertion(oldPercent, oldBlocksTime);
+            }
+        }
+        void enablePromotionThrottle(std::chrono::milliseconds interval)
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enablePromotionThrottle(interval);
+            }
+        }
+        void enableExpiry(std::chrono::milliseconds expireAfter)
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableExpiry(expireAfter);
+            }
+        }
+        void enableRefreshAhead(std::chrono::milliseconds refreshAfter, std::chrono::milliseconds expireAfter,
+                                typename LruCache<Key, Value, Mutex>::Reloader reloader, CacheExecutor &executor)
+        {
+            for (auto &lruSliceCache : lruSliceCaches)
+            {
+                lruSliceCache->enableRefreshAhead(refreshAfter, expireAfter, reloader, executor);
+            }
+        }
+        template <typename Loader>
+        std::shared_future<Value> getAsync(Key key, Loader loader, CacheExecutor &executor)
+        {
+            size_t sliceIndex = Hash(key) % sliceNum_;
+            return sliceLoading_[sliceIndex]->getAsync(key, loader, executor);
+        }
 
     private:
         size_t Hash(Key key)
@@ -282,6 +1643,10 @@ namespace mwm1cCache
         }
         size_t capacity_;
         int sliceNum_;
-        std::vector<std::unique_ptr<LruCache<Key, Value>>> lruSliceCaches;
+        std::vector<std::unique_ptr<LruCache<Key, Value, Mutex>>> lruSliceCaches;
+        // one single-flight table per slice, so misses on different slices never share a lock
+        std::vector<std::unique_ptr<LoadingCache<Key, Value, LruCache<Key, Value, Mutex>>>> sliceLoading_;
+        // declared last: stops the log committer and reaps a running dump child before the slices go away
+        ShardedPersistence<Key, Value> persistence_;
     };
 }
\ No newline at end of file
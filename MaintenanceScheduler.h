@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mwm1cCache
+{
+    /**
+     * One background thread that runs the housekeeping of any number of caches (eviction ahead of demand,
+     * aging, expiry sweeps) so that it is not paid for by whichever request happens to trigger it. A task
+     * does one bounded slice of work per call and returns true while it has more to do; the scheduler
+     * calls the tasks round-robin until all of them are idle, then sleeps for interval or until wake().
+     * A slice must take its cache lock only for its own duration, which is what keeps foreground
+     * latency flat.
+     */
+    class MaintenanceScheduler
+    {
+    public:
+        using Task = std::function<bool()>;
+        using TaskId = uint64_t;
+
+        explicit MaintenanceScheduler(std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+            : interval_(interval), nextId_(1), running_(0), woken_(false), stop_(false)
+        {
+            worker_ = std::thread([this]() { runLoop(); });
+        }
+        // every cache must have removed its task by now
+        ~MaintenanceScheduler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_one();
+            worker_.join();
+        }
+        TaskId add(Task task)
+        {
+            TaskId id;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                id = nextId_++;
+                tasks_[id] = std::make_shared<Task>(std::move(task));
+                woken_ = true;
+            }
+            cond_.notify_one();
+            return id;
+        }
+        // once this returns the task is neither running nor ever called again
+        void remove(TaskId id)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            tasks_.erase(id);
+            // a task removing itself would wait for its own return
+            if (std::this_thread::get_id() != worker_.get_id())
+            {
+                idleCond_.wait(lock, [this, id]() { return running_ != id; });
+            }
+        }
+        // runs the tasks now instead of at the end of the current interval
+        void wake()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                woken_ = true;
+            }
+            cond_.notify_one();
+        }
+
+    private:
+        void runLoop()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_)
+            {
+                cond_.wait_for(lock, interval_, [this]() { return stop_ || woken_; });
+                woken_ = false;
+                bool busy = true;
+                while (busy && !stop_)
+                {
+                    busy = false;
+                    std::vector<TaskId> ids;
+                    for (auto &pair : tasks_)
+                    {
+                        ids.push_back(pair.first);
+                    }
+                    for (TaskId id : ids)
+                    {
+                        auto it = tasks_.find(id);
+                        if (it == tasks_.end())
+                        {
+                            continue;
+                        }
+                        std::shared_ptr<Task> task = it->second;
+                        running_ = id;
+                        lock.unlock();
+                        busy = (*task)() || busy;
+                        lock.lock();
+                        running_ = 0;
+                        idleCond_.notify_all();
+                    }
+                    // let the foreground in between two rounds
+                    if (busy)
+                    {
+                        lock.unlock();
+                        std::this_thread::yield();
+                        lock.lock();
+                    }
+                }
+            }
+        }
+
+        std::chrono::milliseconds interval_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::condition_variable idleCond_;
+        std::map<TaskId, std::shared_ptr<Task>> tasks_;
+        TaskId nextId_;
+        TaskId running_;
+        bool woken_;
+        bool stop_;
+        std::thread worker_;
+    };
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "CacheSnapshot.h"
+
+namespace mwm1cCache
+{
+    enum class LogOp : uint8_t
+    {
+        Put = 1,
+        Remove = 2,
+        Clear = 3
+    };
+
+    /**
+     * Append-only log of one slice's put/remove operations, kept in numbered segment files
+     * "<prefix>.<segment>". Records are buffered in memory and only written and fdatasync'ed by commit(),
+     * so one sync covers every operation since the last group commit.
+     *
+     * record: uint32 length of the rest | uint8 op | key | value (puts only)
+     *
+     * A snapshot makes older segments redundant: rotate() before taking it, and once it is safely on
+     * disk drop the segments before the returned number. Replaying a few operations the snapshot already
+     * contains is harmless, so the order only has to guarantee that nothing after the snapshot is dropped.
+     */
+    template <typename Key, typename Value>
+    class OperationLog
+    {
+    public:
+        explicit OperationLog(std::string prefix)
+            : prefix_(std::move(prefix)), segment_(1), fd_(-1)
+        {
+            std::vector<std::pair<uint64_t, std::string>> segments = listSegments(prefix_);
+            if (!segments.empty())
+            {
+                segment_ = segments.back().first + 1;
+            }
+            openSegment();
+        }
+        ~OperationLog()
+        {
+            commit();
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+            }
+        }
+        OperationLog(const OperationLog &) = delete;
+        OperationLog &operator=(const OperationLog &) = delete;
+
+        // called under the slice lock, only appends to the memory buffer
+        void appendPut(const Key &key, const Value &value)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t start = beginRecord(LogOp::Put);
+            SnapshotSerializer<Key>::write(buffer_, key);
+            SnapshotSerializer<Value>::write(buffer_, value);
+            endRecord(start);
+        }
+        void appendRemove(const Key &key)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t start = beginRecord(LogOp::Remove);
+            SnapshotSerializer<Key>::write(buffer_, key);
+            endRecord(start);
+        }
+        void appendClear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            endRecord(beginRecord(LogOp::Clear));
+        }
+        // group commit: write everything appended so far and sync it
+        bool commit()
+        {
+            std::lock_guard<std::mutex> ioLock(ioMutex_);
+            return writeBuffered();
+        }
+        // seals the current segment and starts a new one, returns the first segment a later snapshot needs
+        uint64_t rotate()
+        {
+            std::lock_guard<std::mutex> ioLock(ioMutex_);
+            // records appended after the swap stay buffered and go to the new segment on the next commit
+            std::string pending;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending.swap(buffer_);
+            }
+            writeAll(pending);
+            ::fdatasync(fd_);
+            ::close(fd_);
+            ++segment_;
+            openSegment();
+            return segment_;
+        }
+        void dropSegmentsBefore(uint64_t segment)
+        {
+            for (auto &entry : listSegments(prefix_))
+            {
+                if (entry.first < segment)
+                {
+                    std::remove(entry.second.c_str());
+                }
+            }
+        }
+        /**
+         * Feeds every record of every segment, oldest first, to apply(op, key, value). A torn record at the
+         * end of a segment (crash during write) ends that segment's replay.
+         */
+        template <typename Apply>
+        static void replay(const std::string &prefix, Apply apply)
+        {
+            for (auto &entry : listSegments(prefix))
+            {
+                SnapshotReader reader;
+                if (!reader.map(entry.second))
+                {
+                    continue;
+                }
+                uint32_t length = 0;
+                while (reader.read(length) && reader.remaining() >= length)
+                {
+                    uint8_t op = 0;
+                    Key key{};
+                    Value value{};
+                    if (!reader.read(op) || op < static_cast<uint8_t>(LogOp::Put) || op > static_cast<uint8_t>(LogOp::Clear))
+                    {
+                        break;
+                    }
+                    if (op == static_cast<uint8_t>(LogOp::Put) && !(reader.read(key) && reader.read(value)))
+                    {
+                        break;
+                    }
+                    if (op == static_cast<uint8_t>(LogOp::Remove) && !reader.read(key))
+                    {
+                        break;
+                    }
+                    apply(static_cast<LogOp>(op), key, value);
+                }
+            }
+        }
+
+    private:
+        static std::vector<std::pair<uint64_t, std::string>> listSegments(const std::string &prefix)
+        {
+            std::vector<std::pair<uint64_t, std::string>> segments;
+            std::filesystem::path prefixPath(prefix);
+            std::filesystem::path dir = prefixPath.has_parent_path() ? prefixPath.parent_path() : std::filesystem::path(".");
+            std::string stem = prefixPath.filename().string() + ".";
+            std::error_code ec;
+            for (auto &file : std::filesystem::directory_iterator(dir, ec))
+            {
+                std::string name = file.path().filename().string();
+                if (name.compare(0, stem.size(), stem) != 0 || name.size() == stem.size() ||
+                    name.find_first_not_of("0123456789", stem.size()) != std::string::npos)
+                {
+                    continue;
+                }
+                segments.emplace_back(std::stoull(name.substr(stem.size())), file.path().string());
+            }
+            std::sort(segments.begin(), segments.end());
+            return segments;
+        }
+        void openSegment()
+        {
+            std::string path = prefix_ + "." + std::to_string(segment_);
+            fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        }
+        size_t beginRecord(LogOp op)
+        {
+            size_t start = buffer_.size();
+            SnapshotSerializer<uint32_t>::write(buffer_, 0);
+            SnapshotSerializer<uint8_t>::write(buffer_, static_cast<uint8_t>(op));
+            return start;
+        }
+        void endRecord(size_t start)
+        {
+            uint32_t length = static_cast<uint32_t>(buffer_.size() - start - sizeof(uint32_t));
+            std::memcpy(&buffer_[start], &length, sizeof(length));
+        }
+        bool writeBuffered()
+        {
+            std::string pending;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending.swap(buffer_);
+            }
+            if (pending.empty())
+            {
+                return true;
+            }
+            return writeAll(pending) && ::fdatasync(fd_) == 0;
+        }
+        bool writeAll(const std::string &data)
+        {
+            size_t written = 0;
+            while (fd_ >= 0 && written < data.size())
+            {
+                ssize_t n = ::write(fd_, data.data() + written, data.size() - written);
+                if (n <= 0)
+                {
+                    return false;
+                }
+                written += static_cast<size_t>(n);
+            }
+            return written == data.size();
+        }
+
+        std::string prefix_;
+        uint64_t segment_;
+        int fd_;
+        // ioMutex_ guards fd_ and segment_, mutex_ only the buffer; appends never wait for I/O
+        std::mutex ioMutex_;
+        std::mutex mutex_;
+        std::string buffer_;
+    };
+
+    // one thread group-committing the logs of all slices of a cache every interval
+    template <typename Key, typename Value>
+    class LogCommitter
+    {
+    public:
+        LogCommitter(std::vector<std::shared_ptr<OperationLog<Key, Value>>> logs, std::chrono::milliseconds interval)
+            : logs_(std::move(logs)), interval_(interval), stop_(false)
+        {
+            thread_ = std::thread([this]() { commitLoop(); });
+        }
+        ~LogCommitter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_one();
+            thread_.join();
+        }
+        const std::vector<std::shared_ptr<OperationLog<Key, Value>>> &logs() const
+        {
+            return logs_;
+        }
+
+    private:
+        void commitLoop()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!cond_.wait_for(lock, interval_, [this]() { return stop_; }))
+            {
+                lock.unlock();
+                for (auto &log : logs_)
+                {
+                    log->commit();
+                }
+                lock.lock();
+            }
+        }
+
+        std::vector<std::shared_ptr<OperationLog<Key, Value>>> logs_;
+        std::chrono::milliseconds interval_;
+        bool stop_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::thread thread_;
+    };
+}
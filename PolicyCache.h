@@ -0,0 +1,335 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CacheLock.h"
+#include "CachePolicy.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Policies for Cache<Key, Value, Index, Eviction, Locking, Storage>. Everything is resolved at compile
+     * time, so a configuration compiles to one class whose put/get inline completely:
+     *
+     * Storage<Key, Value, Hook>  owns the nodes {key, value, hook} and hands out Handles; Hook is the
+     *                            per-node state of the eviction policy
+     * Index<Key, Handle>         key -> handle: find() (nullptr if absent), insert(), erase()
+     * Eviction                   defines Hook; inserted/accessed/removed(storage, handle), victim(storage)
+     * Locking                    any lock from CacheLock.h (std::mutex by default), held for each whole
+     *                            operation; peek() takes it shared where it can
+     */
+    template <typename Key, typename Value, typename Hook>
+    class PooledStorage
+    {
+    public:
+        using Handle = uint32_t;
+        static constexpr Handle NIL = UINT32_MAX;
+
+        struct Node
+        {
+            Key key{};
+            Value value{};
+            Hook hook{};
+        };
+
+        explicit PooledStorage(size_t capacity)
+        {
+            nodes_.reserve(capacity);
+        }
+        Handle allocate(const Key &key, const Value &value)
+        {
+            Handle handle;
+            if (!freeHandles_.empty())
+            {
+                handle = freeHandles_.back();
+                freeHandles_.pop_back();
+            }
+            else
+            {
+                handle = static_cast<Handle>(nodes_.size());
+                nodes_.emplace_back();
+            }
+            Node &node = nodes_[handle];
+            node.key = key;
+            node.value = value;
+            node.hook = Hook{};
+            return handle;
+        }
+        void release(Handle handle)
+        {
+            // drop what the value holds on to now, not when the slot is reused
+            nodes_[handle].value = Value{};
+            freeHandles_.push_back(handle);
+        }
+        Node &operator[](Handle handle)
+        {
+            return nodes_[handle];
+        }
+
+    private:
+        std::vector<Node> nodes_;
+        std::vector<Handle> freeHandles_;
+    };
+
+    template <typename Key, typename Handle>
+    class HashIndex
+    {
+    public:
+        explicit HashIndex(size_t capacity)
+        {
+            map_.reserve(capacity);
+        }
+        const Handle *find(const Key &key) const
+        {
+            auto it = map_.find(key);
+            return it == map_.end() ? nullptr : &it->second;
+        }
+        void insert(const Key &key, Handle handle)
+        {
+            map_.emplace(key, handle);
+        }
+        void erase(const Key &key)
+        {
+            map_.erase(key);
+        }
+        size_t size() const
+        {
+            return map_.size();
+        }
+
+    private:
+        std::unordered_map<Key, Handle> map_;
+    };
+
+    // intrusive list through the node hooks; an access moves the node to the back only for LRU
+    template <bool MoveOnAccess>
+    class ListEviction
+    {
+    public:
+        struct Hook
+        {
+            uint32_t prev = UINT32_MAX;
+            uint32_t next = UINT32_MAX;
+        };
+
+        template <typename Storage>
+        void inserted(Storage &storage, uint32_t handle)
+        {
+            link(storage, handle);
+        }
+        template <typename Storage>
+        void accessed(Storage &storage, uint32_t handle)
+        {
+            if (MoveOnAccess && handle != tail_)
+            {
+                unlink(storage, handle);
+                link(storage, handle);
+            }
+        }
+        template <typename Storage>
+        void removed(Storage &storage, uint32_t handle)
+        {
+            unlink(storage, handle);
+        }
+        template <typename Storage>
+        uint32_t victim(Storage &)
+        {
+            return head_;
+        }
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        template <typename Storage>
+        void link(Storage &storage, uint32_t handle)
+        {
+            Hook &hook = storage[handle].hook;
+            hook.prev = tail_;
+            hook.next = NIL;
+            if (tail_ != NIL)
+            {
+                storage[tail_].hook.next = handle;
+            }
+            else
+            {
+                head_ = handle;
+            }
+            tail_ = handle;
+        }
+        template <typename Storage>
+        void unlink(Storage &storage, uint32_t handle)
+        {
+            Hook &hook = storage[handle].hook;
+            if (hook.prev != NIL)
+            {
+                storage[hook.prev].hook.next = hook.next;
+            }
+            else
+            {
+                head_ = hook.next;
+            }
+            if (hook.next != NIL)
+            {
+                storage[hook.next].hook.prev = hook.prev;
+            }
+            else
+            {
+                tail_ = hook.prev;
+            }
+            hook.prev = hook.next = NIL;
+        }
+
+        uint32_t head_ = NIL;
+        uint32_t tail_ = NIL;
+    };
+    using LruEviction = ListEviction<true>;
+    using FifoEviction = ListEviction<false>;
+
+    /**
+     * Statically composed cache with no virtual calls: the policies above are plain members and every
+     * call resolves at compile time. Not a CachePolicy itself; wrap it in CachePolicyAdapter where one
+     * is needed.
+     */
+    template <typename Key, typename Value, template <typename, typename> class Index = HashIndex,
+              typename Eviction = LruEviction, typename Locking = std::mutex,
+              template <typename, typename, typename> class Storage = PooledStorage>
+    class Cache
+    {
+    public:
+        using KeyType = Key;
+        using ValueType = Value;
+
+        explicit Cache(size_t capacity)
+            : capacity_(capacity), index_(capacity), storage_(capacity)
+        {
+        }
+
+        void put(const Key &key, const Value &value)
+        {
+            if (capacity_ == 0)
+            {
+                return;
+            }
+            std::lock_guard<Locking> lock(mutex_);
+            if (const Handle *handle = index_.find(key))
+            {
+                storage_[*handle].value = value;
+                eviction_.accessed(storage_, *handle);
+                return;
+            }
+            if (index_.size() >= capacity_)
+            {
+                evict();
+            }
+            Handle handle = storage_.allocate(key, value);
+            index_.insert(key, handle);
+            eviction_.inserted(storage_, handle);
+        }
+        bool get(const Key &key, Value &value)
+        {
+            std::lock_guard<Locking> lock(mutex_);
+            const Handle *handle = index_.find(key);
+            if (!handle)
+            {
+                return false;
+            }
+            eviction_.accessed(storage_, *handle);
+            value = storage_[*handle].value;
+            return true;
+        }
+        Value get(const Key &key)
+        {
+            Value value{};
+            get(key, value);
+            return value;
+        }
+        // no eviction bookkeeping, so it only needs a read lock
+        bool peek(const Key &key, Value &value)
+        {
+            ReadLock<Locking> lock(mutex_);
+            const Handle *handle = index_.find(key);
+            if (!handle)
+            {
+                return false;
+            }
+            value = storage_[*handle].value;
+            return true;
+        }
+        bool remove(const Key &key)
+        {
+            std::lock_guard<Locking> lock(mutex_);
+            const Handle *found = index_.find(key);
+            if (!found)
+            {
+                return false;
+            }
+            Handle handle = *found;
+            index_.erase(key);
+            eviction_.removed(storage_, handle);
+            storage_.release(handle);
+            return true;
+        }
+        size_t size()
+        {
+            std::lock_guard<Locking> lock(mutex_);
+            return index_.size();
+        }
+
+    private:
+        using StorageType = Storage<Key, Value, typename Eviction::Hook>;
+        using Handle = typename StorageType::Handle;
+
+        void evict()
+        {
+            Handle handle = eviction_.victim(storage_);
+            index_.erase(storage_[handle].key);
+            eviction_.removed(storage_, handle);
+            storage_.release(handle);
+        }
+
+        size_t capacity_;
+        Locking mutex_;
+        Index<Key, Handle> index_;
+        StorageType storage_;
+        Eviction eviction_;
+    };
+
+    // type-erased view of a statically composed cache, for code written against CachePolicy
+    template <typename Impl>
+    class CachePolicyAdapter : public CachePolicy<typename Impl::KeyType, typename Impl::ValueType>
+    {
+    public:
+        using Key = typename Impl::KeyType;
+        using Value = typename Impl::ValueType;
+
+        template <typename... Args>
+        explicit CachePolicyAdapter(Args &&...args)
+            : cache_(std::forward<Args>(args)...)
+        {
+        }
+        ~CachePolicyAdapter() override = default;
+
+        void put(Key key, Value value) override
+        {
+            cache_.put(key, value);
+        }
+        bool get(Key key, Value &value) override
+        {
+            return cache_.get(key, value);
+        }
+        Value get(Key key) override
+        {
+            return cache_.get(key);
+        }
+        Impl &cache()
+        {
+            return cache_;
+        }
+
+    private:
+        Impl cache_;
+    };
+}
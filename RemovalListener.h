@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace mwm1cCache
+{
+    enum class RemovalCause
+    {
+        Size,     // evicted to make room
+        Expired,  // older than the cache's expiry
+        Replaced, // value overwritten by a put or a refresh
+        Explicit  // removed by remove()/purge()
+    };
+
+    /**
+     * Delivers removal notifications outside the cache lock. Evictions under the lock only push onto a
+     * lock-free multi-producer queue; after releasing the lock the cache calls dispatch(), and whichever
+     * thread wins the draining flag becomes the single consumer and runs the listeners.
+     */
+    template <typename Key, typename Value>
+    class RemovalNotifier
+    {
+    public:
+        using Listener = std::function<void(const Key &, const Value &, RemovalCause)>;
+
+        RemovalNotifier()
+            : head_(&stub_), tail_(&stub_), pending_(0), draining_(false), hasListeners_(false)
+        {
+        }
+        ~RemovalNotifier()
+        {
+            while (Notification *notification = pop())
+            {
+                delete notification;
+            }
+        }
+        void addListener(Listener listener)
+        {
+            std::lock_guard<std::mutex> lock(listenerMutex_);
+            listeners_.push_back(std::move(listener));
+            hasListeners_.store(true, std::memory_order_release);
+        }
+        bool hasListeners() const
+        {
+            return hasListeners_.load(std::memory_order_acquire);
+        }
+        // safe to call under the cache lock, never blocks
+        void enqueue(const Key &key, const Value &value, RemovalCause cause)
+        {
+            if (!hasListeners())
+            {
+                return;
+            }
+            // counted before the push so a dispatcher never sees a popped node it has not counted
+            pending_.fetch_add(1, std::memory_order_release);
+            push(new Notification(key, value, cause));
+        }
+        // call without holding the cache lock
+        void dispatch()
+        {
+            while (pending_.load(std::memory_order_acquire) > 0)
+            {
+                // someone else is draining and will pick up what we queued
+                if (draining_.exchange(true, std::memory_order_acquire))
+                {
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(listenerMutex_);
+                    while (Notification *notification = pop())
+                    {
+                        pending_.fetch_sub(1, std::memory_order_relaxed);
+                        for (auto &listener : listeners_)
+                        {
+                            listener(notification->key, notification->value, notification->cause);
+                        }
+                        delete notification;
+                    }
+                }
+                draining_.store(false, std::memory_order_release);
+                // loop again if a producer pushed after our last pop but before we released the flag
+            }
+        }
+
+    private:
+        struct Link
+        {
+            std::atomic<Link *> next{nullptr};
+        };
+        struct Notification : Link
+        {
+            Key key;
+            Value value;
+            RemovalCause cause;
+            Notification(const Key &key, const Value &value, RemovalCause cause)
+                : key(key), value(value), cause(cause) {}
+        };
+
+        void push(Link *link)
+        {
+            link->next.store(nullptr, std::memory_order_relaxed);
+            Link *prev = head_.exchange(link, std::memory_order_acq_rel);
+            prev->next.store(link, std::memory_order_release);
+        }
+        // consumer side only, returns nullptr when empty or when a producer is half way through push
+        Notification *pop()
+        {
+            Link *tail = tail_;
+            Link *next = tail->next.load(std::memory_order_acquire);
+            if (tail == &stub_)
+            {
+                if (!next)
+                {
+                    return nullptr;
+                }
+                tail_ = next;
+                tail = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next)
+            {
+                tail_ = next;
+                return static_cast<Notification *>(tail);
+            }
+            if (tail != head_.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+            // tail is the last real node, re-insert the stub behind it so tail can be handed out
+            push(&stub_);
+            next = tail->next.load(std::memory_order_acquire);
+            if (next)
+            {
+                tail_ = next;
+                return static_cast<Notification *>(tail);
+            }
+            return nullptr;
+        }
+
+        Link stub_;
+        std::atomic<Link *> head_;
+        Link *tail_;
+        std::atomic<size_t> pending_;
+        std::atomic<bool> draining_;
+        std::atomic<bool> hasListeners_;
+        std::mutex listenerMutex_;
+        std::vector<Listener> listeners_;
+    };
+}
@@ -0,0 +1,572 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CachePolicy.h"
+#include "CacheSnapshot.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Segment-structured cache for small objects with TTLs, after Segcache (NSDI '21). Objects are
+     * serialized back to back into fixed size segments; all segments of a TTL bucket form a chain in
+     * creation order and share one expiry rule, so expiry frees whole segments from the chain heads.
+     *
+     * There are no per-object pointers: the index is a bucketed hash table of 8-byte items
+     * (12-bit tag | 8-bit frequency | 24-bit segment | 20-bit offset), and an object carries an 8-byte
+     * header. When memory runs out, a few consecutive segments of one TTL bucket are merged into the
+     * first of them, keeping only their most frequently read objects, and the rest are freed.
+     *
+     * Keys and values are stored through SnapshotSerializer. A segment expires at its creation time plus
+     * the TTL of the object that opened it, so TTLs are only accurate to the bucket width.
+     */
+    template <typename Key, typename Value>
+    class SegCache : public CachePolicy<Key, Value>
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // a non-positive defaultTtl stores objects without expiry
+        SegCache(size_t capacityBytes, std::chrono::milliseconds defaultTtl, size_t segmentBytes = 1 << 20,
+                 size_t mergeSegments = 4)
+            : segmentBytes_(std::min(std::max(segmentBytes, static_cast<size_t>(4096)), MAX_SEGMENT_BYTES)),
+              maxSegments_(std::min(std::max(capacityBytes / segmentBytes_, static_cast<size_t>(2)), MAX_SEGMENTS)),
+              mergeSegments_(std::max(mergeSegments, static_cast<size_t>(2))), defaultTtl_(defaultTtl),
+              ttlBuckets_(TTL_BUCKETS), mergeCursor_(0), size_(0)
+        {
+            // sized for ~64 byte objects, chains grow past that
+            size_t buckets = 1;
+            while (buckets * (SLOTS - 1) * 64 < capacityBytes && buckets < MAX_INDEX_BUCKETS)
+            {
+                buckets <<= 1;
+            }
+            indexMask_ = buckets - 1;
+            index_.resize(buckets);
+            segments_.reserve(maxSegments_);
+        }
+        ~SegCache() override = default;
+
+        void put(Key key, Value value) override
+        {
+            put(key, value, defaultTtl_);
+        }
+        void put(const Key &key, const Value &value, std::chrono::milliseconds ttl)
+        {
+            std::string keyBytes;
+            std::string valueBytes;
+            SnapshotSerializer<Key>::write(keyBytes, key);
+            SnapshotSerializer<Value>::write(valueBytes, value);
+            size_t objectSize = alignUp(HEADER_BYTES + keyBytes.size() + valueBytes.size());
+            uint64_t hash = hashOf(key);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint8_t freq = 0;
+            Slot old = findByKey(hash, keyBytes);
+            if (old.found())
+            {
+                freq = itemFreq(slotRef(old));
+                unlinkItem(old);
+            }
+            if (objectSize > segmentBytes_)
+            {
+                return;
+            }
+            int32_t segmentId = segmentFor(ttlBucketOf(ttl), ttl, objectSize);
+            if (segmentId < 0)
+            {
+                return;
+            }
+            Segment &segment = segments_[segmentId];
+            uint32_t offset = segment.used;
+            char *object = segment.data.get() + offset;
+            uint32_t keySize = static_cast<uint32_t>(keyBytes.size());
+            uint32_t valueSize = static_cast<uint32_t>(valueBytes.size());
+            std::memcpy(object, &keySize, sizeof(keySize));
+            std::memcpy(object + sizeof(keySize), &valueSize, sizeof(valueSize));
+            std::memcpy(object + HEADER_BYTES, keyBytes.data(), keySize);
+            std::memcpy(object + HEADER_BYTES + keySize, valueBytes.data(), valueSize);
+            segment.used += static_cast<uint32_t>(objectSize);
+            segment.liveBytes += static_cast<uint32_t>(objectSize);
+            ++segment.liveObjects;
+            insertItem(hash, makeItem(hash, freq, segmentId, offset));
+            ++size_;
+        }
+        bool get(Key key, Value &value) override
+        {
+            std::string keyBytes;
+            SnapshotSerializer<Key>::write(keyBytes, key);
+            uint64_t hash = hashOf(key);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot slot = findByKey(hash, keyBytes);
+            if (!slot.found())
+            {
+                return false;
+            }
+            uint64_t &item = slotRef(slot);
+            Segment &segment = segments_[itemSegment(item)];
+            if (segment.expireAt <= Clock::now())
+            {
+                return false;
+            }
+            const char *object = segment.data.get() + itemOffset(item);
+            uint32_t keySize = 0;
+            uint32_t valueSize = 0;
+            std::memcpy(&keySize, object, sizeof(keySize));
+            std::memcpy(&valueSize, object + sizeof(keySize), sizeof(valueSize));
+            const char *cursor = object + HEADER_BYTES + keySize;
+            if (!SnapshotSerializer<Value>::read(cursor, cursor + valueSize, value))
+            {
+                return false;
+            }
+            uint8_t freq = itemFreq(item);
+            if (freq < UINT8_MAX)
+            {
+                item = withFreq(item, freq + 1);
+            }
+            return true;
+        }
+        Value get(Key key) override
+        {
+            Value value{};
+            get(key, value);
+            return value;
+        }
+        void remove(Key key)
+        {
+            std::string keyBytes;
+            SnapshotSerializer<Key>::write(keyBytes, key);
+            uint64_t hash = hashOf(key);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot slot = findByKey(hash, keyBytes);
+            if (slot.found())
+            {
+                unlinkItem(slot);
+            }
+        }
+        // live objects, including expired ones whose segment was not reclaimed yet
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return size_;
+        }
+
+    private:
+        static constexpr size_t HEADER_BYTES = 8;
+        static constexpr size_t ALIGNMENT = 8;
+        static constexpr size_t SLOTS = 8; // slot 0 links the overflow chain
+        static constexpr size_t MAX_SEGMENT_BYTES = (size_t(1) << 20) * ALIGNMENT;
+        static constexpr size_t MAX_SEGMENTS = size_t(1) << 24;
+        static constexpr size_t MAX_INDEX_BUCKETS = size_t(1) << 26;
+        static constexpr size_t TTL_BUCKETS = 1024;
+
+        struct Segment
+        {
+            std::unique_ptr<char[]> data;
+            uint32_t used = 0;
+            uint32_t liveBytes = 0;
+            uint32_t liveObjects = 0;
+            Clock::time_point expireAt;
+            int32_t ttlBucket = -1;
+            int32_t prev = -1;
+            int32_t next = -1;
+        };
+        // segments of one TTL bucket, oldest first; the tail takes the appends
+        struct TtlBucket
+        {
+            int32_t head = -1;
+            int32_t tail = -1;
+            size_t count = 0;
+        };
+        struct IndexBucket
+        {
+            uint64_t slots[SLOTS] = {};
+        };
+        struct Slot
+        {
+            size_t bucket;
+            size_t slot;
+            bool found() const { return slot != 0; }
+        };
+
+        static size_t alignUp(size_t size)
+        {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+        // std::hash is the identity for integers, mix it so tags and bucket bits are independent
+        static uint64_t hashOf(const Key &key)
+        {
+            uint64_t hash = std::hash<Key>()(key);
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+        // 4 ranges of 256 buckets, each range 16x coarser: 128ms, 2s, 32s and 512s wide
+        static size_t ttlBucketOf(std::chrono::milliseconds ttl)
+        {
+            int64_t ms = ttl.count();
+            if (ms <= 0)
+            {
+                return TTL_BUCKETS - 1;
+            }
+            int64_t width = 128;
+            for (size_t range = 0; range < 4; ++range, width <<= 4)
+            {
+                if (ms < width * 256)
+                {
+                    return range * 256 + static_cast<size_t>(ms / width);
+                }
+            }
+            return TTL_BUCKETS - 1;
+        }
+
+        static uint64_t makeItem(uint64_t hash, uint8_t freq, int32_t segment, uint32_t offset)
+        {
+            return (tagOf(hash) << 52) | (static_cast<uint64_t>(freq) << 44) |
+                   (static_cast<uint64_t>(segment) << 20) | (offset / ALIGNMENT);
+        }
+        // never 0, so an item is never mistaken for an empty slot
+        static uint64_t tagOf(uint64_t hash)
+        {
+            uint64_t tag = hash >> 52;
+            return tag ? tag : 1;
+        }
+        static uint64_t itemTag(uint64_t item) { return item >> 52; }
+        static uint8_t itemFreq(uint64_t item) { return static_cast<uint8_t>(item >> 44); }
+        static int32_t itemSegment(uint64_t item) { return static_cast<int32_t>((item >> 20) & 0xffffff); }
+        static uint32_t itemOffset(uint64_t item) { return static_cast<uint32_t>(item & 0xfffff) * ALIGNMENT; }
+        static uint64_t withFreq(uint64_t item, uint8_t freq)
+        {
+            return (item & ~(uint64_t(0xff) << 44)) | (static_cast<uint64_t>(freq) << 44);
+        }
+        static uint64_t withLocation(uint64_t item, int32_t segment, uint32_t offset)
+        {
+            return (item & ~uint64_t(0xfffffffffff)) | (static_cast<uint64_t>(segment) << 20) | (offset / ALIGNMENT);
+        }
+
+        uint64_t &slotRef(const Slot &slot)
+        {
+            return index_[slot.bucket].slots[slot.slot];
+        }
+        uint32_t objectSize(int32_t segmentId, uint32_t offset) const
+        {
+            const char *object = segments_[segmentId].data.get() + offset;
+            uint32_t keySize = 0;
+            uint32_t valueSize = 0;
+            std::memcpy(&keySize, object, sizeof(keySize));
+            std::memcpy(&valueSize, object + sizeof(keySize), sizeof(valueSize));
+            return static_cast<uint32_t>(alignUp(HEADER_BYTES + keySize + valueSize));
+        }
+        // walks the bucket chain of hash, calling match(item) on every item with the right tag
+        template <typename Match>
+        Slot findItem(uint64_t hash, Match match)
+        {
+            uint64_t tag = tagOf(hash);
+            size_t bucket = hash & indexMask_;
+            while (true)
+            {
+                IndexBucket &indexBucket = index_[bucket];
+                for (size_t slot = 1; slot < SLOTS; ++slot)
+                {
+                    uint64_t item = indexBucket.slots[slot];
+                    if (item && itemTag(item) == tag && match(item))
+                    {
+                        return Slot{bucket, slot};
+                    }
+                }
+                if (!indexBucket.slots[0])
+                {
+                    return Slot{bucket, 0};
+                }
+                bucket = static_cast<size_t>(indexBucket.slots[0]);
+            }
+        }
+        Slot findByKey(uint64_t hash, const std::string &keyBytes)
+        {
+            return findItem(hash, [&](uint64_t item) {
+                const char *object = segments_[itemSegment(item)].data.get() + itemOffset(item);
+                uint32_t keySize = 0;
+                std::memcpy(&keySize, object, sizeof(keySize));
+                return keySize == keyBytes.size() && std::memcmp(object + HEADER_BYTES, keyBytes.data(), keySize) == 0;
+            });
+        }
+        void insertItem(uint64_t hash, uint64_t item)
+        {
+            size_t bucket = hash & indexMask_;
+            while (true)
+            {
+                for (size_t slot = 1; slot < SLOTS; ++slot)
+                {
+                    if (!index_[bucket].slots[slot])
+                    {
+                        index_[bucket].slots[slot] = item;
+                        return;
+                    }
+                }
+                if (!index_[bucket].slots[0])
+                {
+                    // overflow buckets live behind the hash buckets and are reused once emptied
+                    index_.emplace_back();
+                    index_[bucket].slots[0] = index_.size() - 1;
+                }
+                bucket = static_cast<size_t>(index_[bucket].slots[0]);
+            }
+        }
+        // drops the item and accounts its object as dead
+        void unlinkItem(const Slot &slot)
+        {
+            uint64_t &item = slotRef(slot);
+            Segment &segment = segments_[itemSegment(item)];
+            segment.liveBytes -= objectSize(itemSegment(item), itemOffset(item));
+            --segment.liveObjects;
+            --size_;
+            item = 0;
+        }
+
+        /**
+         * The tail segment of the TTL bucket if the object fits and the tail has not expired yet (an object
+         * appended to an expired tail would be unreadable right away), else a new one; -1 if nothing can
+         * be freed.
+         */
+        int32_t segmentFor(size_t ttlBucket, std::chrono::milliseconds ttl, size_t objectSize)
+        {
+            TtlBucket &bucket = ttlBuckets_[ttlBucket];
+            Clock::time_point now = Clock::now();
+            if (bucket.tail >= 0 && segments_[bucket.tail].used + objectSize <= segmentBytes_ &&
+                segments_[bucket.tail].expireAt > now)
+            {
+                return bucket.tail;
+            }
+            expireSegments(now);
+            if (freeSegments_.empty() && segments_.size() < maxSegments_)
+            {
+                segments_.emplace_back();
+                segments_.back().data.reset(new char[segmentBytes_]);
+                freeSegments_.push_back(static_cast<int32_t>(segments_.size() - 1));
+            }
+            if (freeSegments_.empty())
+            {
+                evict();
+            }
+            if (freeSegments_.empty())
+            {
+                return -1;
+            }
+            int32_t segmentId = freeSegments_.back();
+            freeSegments_.pop_back();
+            Segment &segment = segments_[segmentId];
+            segment.used = 0;
+            segment.liveBytes = 0;
+            segment.liveObjects = 0;
+            segment.expireAt = ttl.count() > 0 ? now + ttl : Clock::time_point::max();
+            segment.ttlBucket = static_cast<int32_t>(ttlBucket);
+            segment.prev = bucket.tail;
+            segment.next = -1;
+            if (bucket.tail >= 0)
+            {
+                segments_[bucket.tail].next = segmentId;
+            }
+            else
+            {
+                bucket.head = segmentId;
+            }
+            bucket.tail = segmentId;
+            ++bucket.count;
+            return segmentId;
+        }
+        // chains are in creation order and share a TTL, so only their heads need checking
+        void expireSegments(Clock::time_point now)
+        {
+            for (size_t i = 0; i < TTL_BUCKETS; ++i)
+            {
+                while (ttlBuckets_[i].head >= 0 && segments_[ttlBuckets_[i].head].expireAt <= now)
+                {
+                    freeSegment(ttlBuckets_[i].head);
+                }
+            }
+        }
+        void freeSegment(int32_t segmentId)
+        {
+            Segment &segment = segments_[segmentId];
+            for (uint32_t offset = 0; offset < segment.used && segment.liveObjects > 0;)
+            {
+                uint32_t size = objectSize(segmentId, offset);
+                Slot slot = findLocation(segmentId, offset);
+                if (slot.found())
+                {
+                    unlinkItem(slot);
+                }
+                offset += size;
+            }
+            unlinkSegment(segmentId);
+            freeSegments_.push_back(segmentId);
+        }
+        void unlinkSegment(int32_t segmentId)
+        {
+            Segment &segment = segments_[segmentId];
+            TtlBucket &bucket = ttlBuckets_[segment.ttlBucket];
+            if (segment.prev >= 0)
+            {
+                segments_[segment.prev].next = segment.next;
+            }
+            else
+            {
+                bucket.head = segment.next;
+            }
+            if (segment.next >= 0)
+            {
+                segments_[segment.next].prev = segment.prev;
+            }
+            else
+            {
+                bucket.tail = segment.prev;
+            }
+            --bucket.count;
+            segment.ttlBucket = -1;
+            segment.prev = segment.next = -1;
+        }
+        // the index slot pointing at this exact object, if it is still live
+        Slot findLocation(int32_t segmentId, uint32_t offset)
+        {
+            const char *object = segments_[segmentId].data.get() + offset;
+            uint32_t keySize = 0;
+            std::memcpy(&keySize, object, sizeof(keySize));
+            Key key{};
+            const char *cursor = object + HEADER_BYTES;
+            SnapshotSerializer<Key>::read(cursor, cursor + keySize, key);
+            return findItem(hashOf(key), [&](uint64_t item) {
+                return itemSegment(item) == segmentId && itemOffset(item) == offset;
+            });
+        }
+
+        /**
+         * Frees at least one segment: merges up to mergeSegments_ sealed segments from the head of the
+         * next TTL bucket (round robin) into the first of them. Without any bucket holding two sealed
+         * segments, the oldest segment of the next non-empty bucket is dropped whole.
+         */
+        void evict()
+        {
+            for (size_t step = 0; step < TTL_BUCKETS; ++step)
+            {
+                size_t i = (mergeCursor_ + step) % TTL_BUCKETS;
+                if (ttlBuckets_[i].count > 2)
+                {
+                    mergeCursor_ = i + 1;
+                    merge(i);
+                    return;
+                }
+            }
+            for (size_t step = 0; step < TTL_BUCKETS; ++step)
+            {
+                size_t i = (mergeCursor_ + step) % TTL_BUCKETS;
+                if (ttlBuckets_[i].head >= 0)
+                {
+                    mergeCursor_ = i + 1;
+                    freeSegment(ttlBuckets_[i].head);
+                    return;
+                }
+            }
+        }
+        void merge(size_t ttlBucket)
+        {
+            struct Object
+            {
+                Slot slot;
+                int32_t segment;
+                uint32_t offset;
+                uint32_t size;
+                uint8_t freq;
+            };
+            // never merge the tail, it is still taking appends
+            std::vector<int32_t> merged;
+            for (int32_t id = ttlBuckets_[ttlBucket].head; id >= 0 && id != ttlBuckets_[ttlBucket].tail &&
+                                                           merged.size() < mergeSegments_; id = segments_[id].next)
+            {
+                merged.push_back(id);
+            }
+            std::vector<Object> live;
+            size_t liveBytes = 0;
+            std::vector<size_t> bytesByFreq(UINT8_MAX + 1, 0);
+            for (int32_t id : merged)
+            {
+                Segment &segment = segments_[id];
+                for (uint32_t offset = 0; offset < segment.used && segment.liveObjects > 0;)
+                {
+                    uint32_t size = objectSize(id, offset);
+                    Slot slot = findLocation(id, offset);
+                    if (slot.found())
+                    {
+                        uint8_t freq = itemFreq(slotRef(slot));
+                        live.push_back(Object{slot, id, offset, size, freq});
+                        liveBytes += size;
+                        bytesByFreq[freq] += size;
+                    }
+                    offset += size;
+                }
+            }
+            // keep the most frequently read objects that fit into one segment
+            int cutoff = 0;
+            if (liveBytes > segmentBytes_)
+            {
+                size_t kept = 0;
+                cutoff = UINT8_MAX + 1;
+                while (cutoff > 0 && kept + bytesByFreq[cutoff - 1] <= segmentBytes_)
+                {
+                    kept += bytesByFreq[--cutoff];
+                }
+            }
+            int32_t target = merged.front();
+            Segment &targetSegment = segments_[target];
+            uint32_t write = 0;
+            uint32_t keptObjects = 0;
+            for (Object &object : live)
+            {
+                if (object.freq < cutoff)
+                {
+                    unlinkItem(object.slot);
+                    continue;
+                }
+                // the target's own objects come first and only move towards its start
+                std::memmove(targetSegment.data.get() + write, segments_[object.segment].data.get() + object.offset, object.size);
+                uint64_t &item = slotRef(object.slot);
+                // halving ages the counters, so objects have to keep being read to survive the next merge
+                item = withFreq(withLocation(item, target, write), object.freq / 2);
+                write += object.size;
+                ++keptObjects;
+            }
+            targetSegment.used = write;
+            targetSegment.liveBytes = write;
+            targetSegment.liveObjects = keptObjects;
+            for (size_t i = 1; i < merged.size(); ++i)
+            {
+                segments_[merged[i]].liveObjects = 0;
+                unlinkSegment(merged[i]);
+                freeSegments_.push_back(merged[i]);
+            }
+        }
+
+        size_t segmentBytes_;
+        size_t maxSegments_;
+        size_t mergeSegments_;
+        std::chrono::milliseconds defaultTtl_;
+        std::mutex mutex_;
+        std::vector<Segment> segments_;
+        std::vector<int32_t> freeSegments_;
+        std::vector<TtlBucket> ttlBuckets_;
+        size_t mergeCursor_;
+        std::vector<IndexBucket> index_;
+        size_t indexMask_;
+        size_t size_;
+    };
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include "CacheLock.h"
+#include "CachePolicy.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Memcached-style segmented LRU. New entries enter HOT; a get only sets the entry's active bit under
+     * a read lock (shared with the default std::shared_mutex) and never touches a list. A maintainer
+     * thread wakes every interval and, at most MAINTAIN_BATCH moves per pass, pulls the tails back into
+     * their budgets:
+     *
+     *   HOT tail   active -> WARM head, inactive -> COLD head
+     *   WARM tail  active -> WARM head, inactive -> COLD head
+     *   COLD tail  active -> WARM head
+     *
+     * clearing the active bit on every move. A put evicts from the COLD tail, so an entry read since it
+     * reached COLD is usually rescued before its turn comes.
+     */
+    template <typename Key, typename Value, typename Mutex = std::shared_mutex>
+    class SegmentedLruCache : public CachePolicy<Key, Value>
+    {
+    public:
+        SegmentedLruCache(int cap, int hotPercent = 20, int warmPercent = 40,
+                          std::chrono::milliseconds maintainInterval = std::chrono::milliseconds(1))
+            : capacity_(cap > 0 ? static_cast<size_t>(cap) : 0), interval_(maintainInterval), stop_(false)
+        {
+            budget_[HOT] = std::max<size_t>(1, capacity_ * hotPercent / 100);
+            budget_[WARM] = std::max<size_t>(1, capacity_ * warmPercent / 100);
+            budget_[COLD] = capacity_;
+            nodeMap_.reserve(capacity_);
+            maintainer_ = std::thread([this]() { maintainLoop(); });
+        }
+        ~SegmentedLruCache() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(stopMutex_);
+                stop_ = true;
+            }
+            stopCond_.notify_one();
+            maintainer_.join();
+        }
+
+        void put(Key key, Value value) override
+        {
+            if (capacity_ == 0)
+            {
+                return;
+            }
+            std::lock_guard<Mutex> lock(mutex_);
+            auto it = nodeMap_.find(key);
+            if (it != nodeMap_.end())
+            {
+                it->second->value = value;
+                it->second->active.store(true, std::memory_order_relaxed);
+                return;
+            }
+            if (nodeMap_.size() >= capacity_)
+            {
+                evictOne();
+            }
+            segments_[HOT].emplace_front(key, value);
+            nodeMap_[key] = segments_[HOT].begin();
+        }
+        bool get(Key key, Value &value) override
+        {
+            ReadLock<Mutex> lock(mutex_);
+            auto it = nodeMap_.find(key);
+            if (it == nodeMap_.end())
+            {
+                return false;
+            }
+            Node &node = *it->second;
+            if (!node.active.load(std::memory_order_relaxed))
+            {
+                node.active.store(true, std::memory_order_relaxed);
+            }
+            value = node.value;
+            return true;
+        }
+        Value get(Key key) override
+        {
+            Value value{};
+            get(key, value);
+            return value;
+        }
+        // entries per segment, for tuning the ratios
+        void segmentSizes(size_t &hot, size_t &warm, size_t &cold)
+        {
+            ReadLock<Mutex> lock(mutex_);
+            hot = segments_[HOT].size();
+            warm = segments_[WARM].size();
+            cold = segments_[COLD].size();
+        }
+
+    private:
+        enum Segment
+        {
+            HOT,
+            WARM,
+            COLD,
+            SEGMENTS
+        };
+        static constexpr size_t MAINTAIN_BATCH = 256;
+
+        struct Node
+        {
+            Node(const Key &key, const Value &value)
+                : key(key), value(value), segment(HOT), active(false)
+            {
+            }
+            Key key;
+            Value value;
+            Segment segment;
+            // set by readers under the shared lock, cleared by the maintainer under the exclusive one
+            std::atomic<bool> active;
+        };
+        using NodeList = std::list<Node>;
+
+        // splice keeps the iterator in nodeMap_ valid
+        void moveToHead(typename NodeList::iterator node, Segment to)
+        {
+            node->active.store(false, std::memory_order_relaxed);
+            segments_[to].splice(segments_[to].begin(), segments_[node->segment], node);
+            node->segment = to;
+        }
+        /**
+         * Evicts from the COLD tail, or from HOT/WARM while the maintainer lags behind. Active tails get
+         * the maintainer's treatment inline (moved to WARM, bit cleared) for up to MAINTAIN_BATCH steps.
+         */
+        void evictOne()
+        {
+            for (size_t tries = 0; tries <= MAINTAIN_BATCH; ++tries)
+            {
+                Segment from = COLD;
+                if (segments_[COLD].empty())
+                {
+                    from = segments_[HOT].size() > budget_[HOT] || segments_[WARM].empty() ? HOT : WARM;
+                }
+                auto tail = std::prev(segments_[from].end());
+                if (tries < MAINTAIN_BATCH && tail->active.load(std::memory_order_relaxed))
+                {
+                    moveToHead(tail, WARM);
+                    continue;
+                }
+                nodeMap_.erase(tail->key);
+                segments_[from].erase(tail);
+                return;
+            }
+        }
+        // one bounded pass; returns false when every segment was already within budget
+        bool maintain()
+        {
+            std::lock_guard<Mutex> lock(mutex_);
+            size_t moves = 0;
+            while (moves < MAINTAIN_BATCH && segments_[HOT].size() > budget_[HOT])
+            {
+                auto tail = std::prev(segments_[HOT].end());
+                moveToHead(tail, tail->active.load(std::memory_order_relaxed) ? WARM : COLD);
+                ++moves;
+            }
+            // every active WARM tail is bumped once at most, so the loop ends even if all are active
+            size_t bumps = segments_[WARM].size();
+            while (moves < MAINTAIN_BATCH && segments_[WARM].size() > budget_[WARM] && bumps > 0)
+            {
+                auto tail = std::prev(segments_[WARM].end());
+                bool active = tail->active.load(std::memory_order_relaxed);
+                moveToHead(tail, active ? WARM : COLD);
+                bumps -= active ? 1 : 0;
+                ++moves;
+            }
+            while (moves < MAINTAIN_BATCH && !segments_[COLD].empty())
+            {
+                auto tail = std::prev(segments_[COLD].end());
+                if (!tail->active.load(std::memory_order_relaxed))
+                {
+                    break;
+                }
+                moveToHead(tail, WARM);
+                ++moves;
+            }
+            return moves == MAINTAIN_BATCH;
+        }
+        void maintainLoop()
+        {
+            std::unique_lock<std::mutex> lock(stopMutex_);
+            while (!stop_)
+            {
+                stopCond_.wait_for(lock, interval_, [this]() { return stop_.load(); });
+                lock.unlock();
+                // a full batch means there is more to do, go on after letting the foreground in
+                while (maintain() && !stop_)
+                {
+                    std::this_thread::yield();
+                }
+                lock.lock();
+            }
+        }
+
+        size_t capacity_;
+        size_t budget_[SEGMENTS];
+        Mutex mutex_;
+        NodeList segments_[SEGMENTS];
+        std::unordered_map<Key, typename NodeList::iterator> nodeMap_;
+        std::chrono::milliseconds interval_;
+        std::mutex stopMutex_;
+        std::condition_variable stopCond_;
+        std::atomic<bool> stop_;
+        std::thread maintainer_;
+    };
+}
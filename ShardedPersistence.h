@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CacheSnapshot.h"
+#include "OperationLog.h"
+
+namespace mwm1cCache
+{
+    /**
+     * Snapshot and operation log handling shared by the sharded caches. Slice i persists to
+     * "<path>.<i>" (snapshot) and "<path>.<i>.log.<segment>" (operation log). A snapshot taken to the
+     * log path rotates the logs first and, once written, drops the segments it covers.
+     */
+    template <typename Key, typename Value>
+    class ShardedPersistence
+    {
+    public:
+        static std::string logPrefix(const std::string &path, size_t sliceIndex)
+        {
+            return BackgroundSnapshot::slicePath(path, sliceIndex) + ".log";
+        }
+
+        template <typename Cache>
+        bool saveSnapshot(const std::vector<std::unique_ptr<Cache>> &slices, const std::string &path)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<uint64_t> keepFrom = rotateLogs(path);
+            bool ok = true;
+            for (size_t i = 0; i < slices.size(); ++i)
+            {
+                ok = slices[i]->saveSnapshot(BackgroundSnapshot::slicePath(path, i)) && ok;
+            }
+            if (ok)
+            {
+                dropLogs(keepFrom);
+            }
+            return ok;
+        }
+        template <typename Cache>
+        bool loadSnapshot(const std::vector<std::unique_ptr<Cache>> &slices, const std::string &path)
+        {
+            bool ok = true;
+            for (size_t i = 0; i < slices.size(); ++i)
+            {
+                ok = slices[i]->loadSnapshot(BackgroundSnapshot::slicePath(path, i)) && ok;
+            }
+            return ok;
+        }
+        template <typename Cache>
+        bool saveSnapshotInBackground(const std::vector<std::unique_ptr<Cache>> &slices, const std::string &path)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // everything logged before the rotation happened before the fork, so the child's image has it
+            std::vector<uint64_t> keepFrom = rotateLogs(path);
+            if (!backgroundSnapshot_.start(slices, path))
+            {
+                return false;
+            }
+            pendingKeepFrom_ = keepFrom;
+            return true;
+        }
+        bool snapshotRunning()
+        {
+            return backgroundSnapshot_.running();
+        }
+        bool waitSnapshot()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bool ok = backgroundSnapshot_.wait();
+            if (ok)
+            {
+                dropLogs(pendingKeepFrom_);
+            }
+            pendingKeepFrom_.clear();
+            return ok;
+        }
+
+        template <typename Cache>
+        void enableOperationLog(const std::vector<std::unique_ptr<Cache>> &slices, const std::string &path,
+                                std::chrono::milliseconds commitInterval)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<std::shared_ptr<OperationLog<Key, Value>>> logs;
+            for (size_t i = 0; i < slices.size(); ++i)
+            {
+                auto log = std::make_shared<OperationLog<Key, Value>>(logPrefix(path, i));
+                slices[i]->enableOperationLog(log);
+                logs.push_back(log);
+            }
+            logPath_ = path;
+            logCommitter_ = std::make_unique<LogCommitter<Key, Value>>(std::move(logs), commitInterval);
+        }
+        /**
+         * Restores every slice from its snapshot (if any) plus its log tail, one thread per slice.
+         * apply(slice, op, key, value) replays a logged operation on the slice.
+         */
+        template <typename Cache, typename Apply>
+        void recover(const std::vector<std::unique_ptr<Cache>> &slices, const std::string &path, Apply apply)
+        {
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < slices.size(); ++i)
+            {
+                workers.emplace_back([&slices, &path, &apply, i]() {
+                    Cache &slice = *slices[i];
+                    // without a snapshot the whole log is replayed onto the empty slice
+                    slice.loadSnapshot(BackgroundSnapshot::slicePath(path, i));
+                    OperationLog<Key, Value>::replay(logPrefix(path, i), [&](LogOp op, const Key &key, const Value &value) {
+                        apply(slice, op, key, value);
+                    });
+                });
+            }
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+    private:
+        std::vector<uint64_t> rotateLogs(const std::string &snapshotPath)
+        {
+            std::vector<uint64_t> keepFrom;
+            if (logCommitter_ && snapshotPath == logPath_)
+            {
+                for (auto &log : logCommitter_->logs())
+                {
+                    keepFrom.push_back(log->rotate());
+                }
+            }
+            return keepFrom;
+        }
+        void dropLogs(const std::vector<uint64_t> &keepFrom)
+        {
+            for (size_t i = 0; i < keepFrom.size(); ++i)
+            {
+                logCommitter_->logs()[i]->dropSegmentsBefore(keepFrom[i]);
+            }
+        }
+
+        std::mutex mutex_;
+        std::string logPath_;
+        std::unique_ptr<LogCommitter<Key, Value>> logCommitter_;
+        std::vector<uint64_t> pendingKeepFrom_;
+        BackgroundSnapshot backgroundSnapshot_;
+    };
+}
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "CacheSnapshot.h"
+
+namespace mwm1cCache
+{
+    struct SlabStats
+    {
+        size_t mappedBytes;    // everything taken from the OS
+        size_t pooledBytes;    // empty pages waiting to be recarved, already given back with MADV_DONTNEED
+        size_t chunkBytes;     // chunks handed out, including their unused tails
+        size_t requestedBytes; // what the callers asked for
+    };
+
+    /**
+     * memcached-style slab allocator. Memory is mmap'ed in 1MB pages aligned to their size; each page is
+     * carved into equal chunks of one size class, the classes growing by a constant factor. A chunk's page,
+     * and with it the page's class and owner, is found by masking the chunk address, so freeing needs no
+     * lookup table.
+     *
+     * Rebalancing works at page granularity: once every chunk of a page is free again the page goes
+     * back to a shared pool (its memory returned with MADV_DONTNEED) and can be recarved for any class.
+     * Values larger than the biggest class get a dedicated mapping.
+     *
+     * The allocator must outlive every chunk it handed out.
+     */
+    class SlabAllocator
+    {
+    public:
+        static constexpr size_t PAGE_SIZE = 1 << 20;
+
+        explicit SlabAllocator(size_t minChunk = 64, double growthFactor = 1.25)
+            : mappedBytes_(0), pooledPages_(0), chunkBytes_(0), requestedBytes_(0)
+        {
+            size_t chunkSize = std::max(align(minChunk), sizeof(void *));
+            while (chunkSize <= MAX_CHUNK)
+            {
+                classes_.emplace_back(new SlabClass(chunkSize));
+                chunkSize = align(std::max(chunkSize + ALIGNMENT, static_cast<size_t>(chunkSize * growthFactor)));
+            }
+            // the factor rarely lands on MAX_CHUNK, the last class has to cover every size up to it
+            if (classes_.empty() || classes_.back()->chunkSize < MAX_CHUNK)
+            {
+                classes_.emplace_back(new SlabClass(MAX_CHUNK));
+            }
+        }
+        ~SlabAllocator()
+        {
+            for (auto &mapping : mappings_)
+            {
+                ::munmap(mapping.first, mapping.second);
+            }
+        }
+        SlabAllocator(const SlabAllocator &) = delete;
+        SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+        // process-wide instance, used where no allocator can be passed in (e.g. restoring snapshots)
+        static SlabAllocator &shared()
+        {
+            static SlabAllocator allocator;
+            return allocator;
+        }
+
+        // throws std::bad_alloc if the OS refuses more memory
+        void *allocate(size_t size)
+        {
+            requestedBytes_.fetch_add(size, std::memory_order_relaxed);
+            if (size > MAX_CHUNK)
+            {
+                return allocateHuge(size);
+            }
+            auto it = std::lower_bound(classes_.begin(), classes_.end(), size,
+                                       [](const std::unique_ptr<SlabClass> &slabClass, size_t size) { return slabClass->chunkSize < size; });
+            SlabClass &slabClass = **it;
+            std::lock_guard<std::mutex> lock(slabClass.mutex);
+            if (!slabClass.partial)
+            {
+                Page *page = takePage();
+                page->classIndex = static_cast<uint32_t>(it - classes_.begin());
+                page->chunkSize = slabClass.chunkSize;
+                page->capacity = static_cast<uint32_t>((PAGE_SIZE - PAGE_HEADER) / slabClass.chunkSize);
+                linkPartial(slabClass, page);
+            }
+            Page *page = slabClass.partial;
+            void *chunk;
+            if (page->freeList)
+            {
+                chunk = page->freeList;
+                page->freeList = *static_cast<void **>(chunk);
+            }
+            else
+            {
+                // carve lazily, untouched chunks never become resident
+                chunk = reinterpret_cast<char *>(page) + PAGE_HEADER + static_cast<size_t>(page->carved) * page->chunkSize;
+                ++page->carved;
+            }
+            if (++page->used == page->capacity)
+            {
+                unlinkPartial(slabClass, page);
+            }
+            chunkBytes_.fetch_add(page->chunkSize, std::memory_order_relaxed);
+            return chunk;
+        }
+        static void deallocate(void *chunk, size_t size)
+        {
+            Page *page = pageOf(chunk);
+            page->owner->release(page, chunk, size);
+        }
+        SlabStats stats()
+        {
+            std::lock_guard<std::mutex> lock(poolMutex_);
+            return SlabStats{mappedBytes_, pooledPages_ * PAGE_SIZE, chunkBytes_.load(std::memory_order_relaxed),
+                             requestedBytes_.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        static constexpr size_t ALIGNMENT = 8;
+        static constexpr size_t PAGE_HEADER = 64;
+        static constexpr size_t MAX_CHUNK = (PAGE_SIZE - PAGE_HEADER) / 2;
+        static constexpr uint32_t HUGE_CLASS = UINT32_MAX;
+
+        // lives in the first bytes of every page
+        struct Page
+        {
+            SlabAllocator *owner;
+            Page *prev;
+            Page *next;
+            void *freeList;
+            size_t chunkSize;
+            uint32_t classIndex;
+            uint32_t capacity;
+            uint32_t carved;
+            uint32_t used;
+        };
+        static_assert(sizeof(Page) <= PAGE_HEADER, "page header must fit in front of the first chunk");
+
+        struct SlabClass
+        {
+            explicit SlabClass(size_t chunkSize) : chunkSize(chunkSize), partial(nullptr) {}
+            size_t chunkSize;
+            std::mutex mutex;
+            // pages with at least one free chunk
+            Page *partial;
+        };
+
+        static size_t align(size_t size)
+        {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+        static Page *pageOf(void *chunk)
+        {
+            return reinterpret_cast<Page *>(reinterpret_cast<uintptr_t>(chunk) & ~(PAGE_SIZE - 1));
+        }
+        static void linkPartial(SlabClass &slabClass, Page *page)
+        {
+            page->prev = nullptr;
+            page->next = slabClass.partial;
+            if (slabClass.partial)
+            {
+                slabClass.partial->prev = page;
+            }
+            slabClass.partial = page;
+        }
+        static void unlinkPartial(SlabClass &slabClass, Page *page)
+        {
+            if (page->prev)
+            {
+                page->prev->next = page->next;
+            }
+            else
+            {
+                slabClass.partial = page->next;
+            }
+            if (page->next)
+            {
+                page->next->prev = page->prev;
+            }
+            page->prev = page->next = nullptr;
+        }
+
+        void release(Page *page, void *chunk, size_t size)
+        {
+            requestedBytes_.fetch_sub(size, std::memory_order_relaxed);
+            if (page->classIndex == HUGE_CLASS)
+            {
+                releaseHuge(page);
+                return;
+            }
+            SlabClass &slabClass = *classes_[page->classIndex];
+            std::lock_guard<std::mutex> lock(slabClass.mutex);
+            chunkBytes_.fetch_sub(page->chunkSize, std::memory_order_relaxed);
+            *static_cast<void **>(chunk) = page->freeList;
+            page->freeList = chunk;
+            if (page->used-- == page->capacity)
+            {
+                linkPartial(slabClass, page);
+            }
+            // keep the last partial page so a class hovering around a page boundary does not thrash
+            if (page->used == 0 && (page->prev || page->next))
+            {
+                unlinkPartial(slabClass, page);
+                givePage(page);
+            }
+        }
+        Page *takePage()
+        {
+            {
+                std::lock_guard<std::mutex> lock(poolMutex_);
+                if (!pool_.empty())
+                {
+                    Page *page = pool_.back();
+                    pool_.pop_back();
+                    --pooledPages_;
+                    resetPage(page);
+                    return page;
+                }
+            }
+            Page *page = static_cast<Page *>(mapAligned(PAGE_SIZE));
+            resetPage(page);
+            return page;
+        }
+        void givePage(Page *page)
+        {
+            // keep the header, hand the rest of the page back to the OS until it is recarved
+            ::madvise(reinterpret_cast<char *>(page) + ::getpagesize(), PAGE_SIZE - ::getpagesize(), MADV_DONTNEED);
+            std::lock_guard<std::mutex> lock(poolMutex_);
+            pool_.push_back(page);
+            ++pooledPages_;
+        }
+        void resetPage(Page *page)
+        {
+            std::memset(page, 0, sizeof(Page));
+            page->owner = this;
+        }
+        void *allocateHuge(size_t size)
+        {
+            size_t length = (PAGE_HEADER + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+            Page *page = static_cast<Page *>(mapAligned(length));
+            resetPage(page);
+            page->classIndex = HUGE_CLASS;
+            page->chunkSize = length;
+            chunkBytes_.fetch_add(length, std::memory_order_relaxed);
+            return reinterpret_cast<char *>(page) + PAGE_HEADER;
+        }
+        void releaseHuge(Page *page)
+        {
+            size_t length = page->chunkSize;
+            chunkBytes_.fetch_sub(length, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(poolMutex_);
+            for (auto it = mappings_.begin(); it != mappings_.end(); ++it)
+            {
+                if (it->first == page)
+                {
+                    mappings_.erase(it);
+                    break;
+                }
+            }
+            mappedBytes_ -= length;
+            ::munmap(page, length);
+        }
+        // over-maps by one page and trims both ends so the result is PAGE_SIZE aligned
+        void *mapAligned(size_t length)
+        {
+            size_t padded = length + PAGE_SIZE;
+            void *raw = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+            {
+                throw std::bad_alloc();
+            }
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+            if (aligned > start)
+            {
+                ::munmap(raw, aligned - start);
+            }
+            size_t tail = start + padded - (aligned + length);
+            if (tail > 0)
+            {
+                ::munmap(reinterpret_cast<void *>(aligned + length), tail);
+            }
+            std::lock_guard<std::mutex> lock(poolMutex_);
+            mappings_.emplace_back(reinterpret_cast<void *>(aligned), length);
+            mappedBytes_ += length;
+            return reinterpret_cast<void *>(aligned);
+        }
+
+        std::vector<std::unique_ptr<SlabClass>> classes_;
+        std::mutex poolMutex_;
+        std::vector<Page *> pool_;
+        std::vector<std::pair<void *, size_t>> mappings_;
+        size_t mappedBytes_;
+        size_t pooledPages_;
+        std::atomic<size_t> chunkBytes_;
+        std::atomic<size_t> requestedBytes_;
+    };
+
+    /**
+     * Immutable byte buffer stored inline in a slab chunk, for use as a cache Value instead of std::string.
+     * The handle is one pointer; copies share the chunk through a reference count kept in front of the
+     * bytes, so handing a value out of the cache never allocates.
+     */
+    class SlabBuffer
+    {
+    public:
+        SlabBuffer()
+            : chunk_(nullptr)
+        {
+        }
+        SlabBuffer(SlabAllocator &allocator, const char *data, size_t size)
+            : chunk_(static_cast<Chunk *>(allocator.allocate(sizeof(Chunk) + size)))
+        {
+            new (chunk_) Chunk(static_cast<uint32_t>(size));
+            std::memcpy(reinterpret_cast<char *>(chunk_ + 1), data, size);
+        }
+        SlabBuffer(SlabAllocator &allocator, const std::string &value)
+            : SlabBuffer(allocator, value.data(), value.size())
+        {
+        }
+        SlabBuffer(const SlabBuffer &other)
+            : chunk_(other.chunk_)
+        {
+            retain();
+        }
+        SlabBuffer(SlabBuffer &&other) noexcept
+            : chunk_(other.chunk_)
+        {
+            other.chunk_ = nullptr;
+        }
+        SlabBuffer &operator=(SlabBuffer other) noexcept
+        {
+            std::swap(chunk_, other.chunk_);
+            return *this;
+        }
+        ~SlabBuffer()
+        {
+            if (chunk_ && chunk_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                size_t size = sizeof(Chunk) + chunk_->size;
+                chunk_->~Chunk();
+                SlabAllocator::deallocate(chunk_, size);
+            }
+        }
+
+        const char *data() const
+        {
+            return chunk_ ? reinterpret_cast<const char *>(chunk_ + 1) : "";
+        }
+        size_t size() const
+        {
+            return chunk_ ? chunk_->size : 0;
+        }
+        bool empty() const
+        {
+            return size() == 0;
+        }
+        std::string str() const
+        {
+            return std::string(data(), size());
+        }
+
+    private:
+        struct Chunk
+        {
+            explicit Chunk(uint32_t size) : refs(1), size(size) {}
+            std::atomic<uint32_t> refs;
+            uint32_t size;
+        };
+
+        void retain()
+        {
+            if (chunk_)
+            {
+                chunk_->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        Chunk *chunk_;
+    };
+
+    // snapshots and operation logs store the bytes; restored buffers come from SlabAllocator::shared()
+    template <>
+    struct SnapshotSerializer<SlabBuffer>
+    {
+        static void write(std::string &out, const SlabBuffer &value)
+        {
+            SnapshotSerializer<uint32_t>::write(out, static_cast<uint32_t>(value.size()));
+            out.append(value.data(), value.size());
+        }
+        static bool read(const char *&cursor, const char *end, SlabBuffer &value)
+        {
+            uint32_t size = 0;
+            if (!SnapshotSerializer<uint32_t>::read(cursor, end, size) || static_cast<size_t>(end - cursor) < size)
+            {
+                return false;
+            }
+            value = SlabBuffer(SlabAllocator::shared(), cursor, size);
+            cursor += size;
+            return true;
+        }
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "CachePolicy.h"
+#include "DiskTier.h"
+#include "LRUCache.h"
+#include "RemovalListener.h"
+
+namespace mwm1cCache
+{
+    struct TierStats
+    {
+        uint64_t memoryHits;
+        uint64_t diskHits;
+        uint64_t misses;
+    };
+
+    /**
+     * Memory cache in front of a DiskTier. Entries the memory policy evicts for size are demoted to disk
+     * by a removal listener, a memory miss checks the disk before reporting a miss, and a disk hit is
+     * promoted back into memory. The tiers are exclusive: an entry lives in at most one of them.
+     *
+     * MemoryCache is any cache with a (capacity) constructor and addRemovalListener(), i.e. LruCache or
+     * ArcCache. Demotion runs right after the evicting put releases the memory lock, so for that short
+     * window a concurrent get of the victim can miss both tiers.
+     */
+    template <typename Key, typename Value, typename MemoryCache = LruCache<Key, Value>>
+    class TieredCache : public CachePolicy<Key, Value>
+    {
+    public:
+        TieredCache(int memoryCapacity, std::string diskPath, size_t diskCapacityBytes,
+                    size_t segmentBytes = 4 << 20, typename DiskTier<Key, Value>::Admission admission = nullptr)
+            : disk_(std::move(diskPath), diskCapacityBytes, segmentBytes, std::move(admission)),
+              memory_(memoryCapacity), memoryHits_(0), diskHits_(0), misses_(0)
+        {
+            memory_.addRemovalListener([this](const Key &key, const Value &value, RemovalCause cause) {
+                // expired and overwritten values are dead, only capacity victims are worth keeping
+                if (cause == RemovalCause::Size)
+                {
+                    disk_.put(key, value);
+                }
+            });
+        }
+        ~TieredCache() override = default;
+
+        void put(Key key, Value value) override
+        {
+            // drop an older demoted copy so it cannot resurface once the new value is evicted
+            disk_.remove(key);
+            memory_.put(key, value);
+        }
+        bool get(Key key, Value &value) override
+        {
+            if (memory_.get(key, value))
+            {
+                memoryHits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (disk_.take(key, value))
+            {
+                diskHits_.fetch_add(1, std::memory_order_relaxed);
+                memory_.put(key, value);
+                return true;
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Value get(Key key) override
+        {
+            Value value{};
+            get(key, value);
+            return value;
+        }
+        TierStats stats() const
+        {
+            return TierStats{memoryHits_.load(std::memory_order_relaxed), diskHits_.load(std::memory_order_relaxed),
+                             misses_.load(std::memory_order_relaxed)};
+        }
+        size_t diskEntries()
+        {
+            return disk_.size();
+        }
+        size_t diskBytes()
+        {
+            return disk_.diskBytes();
+        }
+
+    private:
+        // declared before memory_, so the demotion listener never outlives the disk tier
+        DiskTier<Key, Value> disk_;
+        MemoryCache memory_;
+        std::atomic<uint64_t> memoryHits_;
+        std::atomic<uint64_t> diskHits_;
+        std::atomic<uint64_t> misses_;
+    };
+}
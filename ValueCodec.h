@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+#include "CacheSnapshot.h"
+#include "LRUCache.h"
+
+namespace mwm1cCache
+{
+    class ValueCodec
+    {
+    public:
+        virtual ~ValueCodec() {};
+        virtual std::string compress(const std::string &input) const = 0;
+        // false on corrupt input
+        virtual bool decompress(const char *data, size_t size, std::string &output) const = 0;
+    };
+
+    /**
+     * Byte-oriented LZ77 in the spirit of LZ4: greedy matching through a 4096 entry hash of 4-byte
+     * sequences, 64KB window, no entropy coding. Fast enough to sit on the put path of text values.
+     *
+     * block:    uint32 raw size | sequence...
+     * sequence: token (literal length << 4 | match length - 4) | [length bytes] | literals
+     *           | uint16 match offset | [length bytes]
+     * A nibble of 15 continues in length bytes of 255 until one below 255. The last sequence ends after
+     * its literals.
+     */
+    class LzCodec : public ValueCodec
+    {
+    public:
+        std::string compress(const std::string &input) const override
+        {
+            const uint8_t *src = reinterpret_cast<const uint8_t *>(input.data());
+            size_t size = input.size();
+            std::string output;
+            output.reserve(size / 2 + 16);
+            SnapshotSerializer<uint32_t>::write(output, static_cast<uint32_t>(size));
+
+            thread_local std::vector<uint32_t> table(HASH_SIZE);
+            std::fill(table.begin(), table.end(), 0);
+            size_t anchor = 0;
+            size_t pos = 0;
+            while (size >= MIN_MATCH && pos <= size - MIN_MATCH)
+            {
+                uint32_t sequence = read32(src + pos);
+                uint32_t &slot = table[(sequence * 2654435761u) >> (32 - HASH_BITS)];
+                // slots hold position + 1, 0 is empty
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(pos + 1);
+                if (candidate && pos - (candidate - 1) <= MAX_OFFSET && read32(src + candidate - 1) == sequence)
+                {
+                    size_t ref = candidate - 1;
+                    size_t length = MIN_MATCH;
+                    while (pos + length < size && src[ref + length] == src[pos + length])
+                    {
+                        ++length;
+                    }
+                    writeSequence(output, src + anchor, pos - anchor, pos - ref, length);
+                    pos += length;
+                    anchor = pos;
+                }
+                else
+                {
+                    // skip faster through data that does not compress
+                    pos += 1 + ((pos - anchor) >> 6);
+                }
+            }
+            if (anchor < size || size == 0)
+            {
+                writeLiterals(output, src + anchor, size - anchor, 0);
+            }
+            return output;
+        }
+        bool decompress(const char *data, size_t size, std::string &output) const override
+        {
+            const uint8_t *in = reinterpret_cast<const uint8_t *>(data);
+            const uint8_t *end = in + size;
+            uint32_t rawSize = 0;
+            const char *cursor = data;
+            if (!SnapshotSerializer<uint32_t>::read(cursor, data + size, rawSize))
+            {
+                return false;
+            }
+            in += sizeof(uint32_t);
+            // the header is untrusted, so never allocate more than the block could expand to
+            if (rawSize > (size - sizeof(uint32_t)) * MAX_EXPANSION + MIN_MATCH + 15)
+            {
+                return false;
+            }
+            output.resize(rawSize);
+            char *out = &output[0];
+            size_t written = 0;
+            while (in < end)
+            {
+                uint8_t token = *in++;
+                size_t literals = token >> 4;
+                if (literals == 15 && !readLength(in, end, literals))
+                {
+                    return false;
+                }
+                if (static_cast<size_t>(end - in) < literals || rawSize - written < literals)
+                {
+                    return false;
+                }
+                std::memcpy(out + written, in, literals);
+                in += literals;
+                written += literals;
+                if (in == end)
+                {
+                    break;
+                }
+                if (end - in < 2)
+                {
+                    return false;
+                }
+                size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+                in += 2;
+                size_t length = token & 15;
+                if (length == 15 && !readLength(in, end, length))
+                {
+                    return false;
+                }
+                length += MIN_MATCH;
+                if (offset == 0 || offset > written || rawSize - written < length)
+                {
+                    return false;
+                }
+                if (offset >= length)
+                {
+                    std::memcpy(out + written, out + written - offset, length);
+                }
+                else
+                {
+                    // overlapping match repeats the last offset bytes
+                    for (size_t i = 0; i < length; ++i)
+                    {
+                        out[written + i] = out[written - offset + i];
+                    }
+                }
+                written += length;
+            }
+            return written == rawSize;
+        }
+
+    private:
+        static constexpr size_t MIN_MATCH = 4;
+        static constexpr size_t MAX_OFFSET = 65535;
+        // a length byte of 255 is the densest encoding: one input byte, 255 output bytes
+        static constexpr size_t MAX_EXPANSION = 255;
+        static constexpr int HASH_BITS = 12;
+        static constexpr size_t HASH_SIZE = size_t(1) << HASH_BITS;
+
+        static uint32_t read32(const uint8_t *p)
+        {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        static void writeLength(std::string &output, size_t length)
+        {
+            while (length >= 255)
+            {
+                output.push_back(static_cast<char>(255));
+                length -= 255;
+            }
+            output.push_back(static_cast<char>(length));
+        }
+        static bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length)
+        {
+            uint8_t byte;
+            do
+            {
+                if (in == end)
+                {
+                    return false;
+                }
+                byte = *in++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+        static void writeLiterals(std::string &output, const uint8_t *literals, size_t count, size_t matchNibble)
+        {
+            output.push_back(static_cast<char>((std::min<size_t>(count, 15) << 4) | matchNibble));
+            if (count >= 15)
+            {
+                writeLength(output, count - 15);
+            }
+            output.append(reinterpret_cast<const char *>(literals), count);
+        }
+        static void writeSequence(std::string &output, const uint8_t *literals, size_t count, size_t offset, size_t length)
+        {
+            size_t extra = length - MIN_MATCH;
+            writeLiterals(output, literals, count, std::min<size_t>(extra, 15));
+            output.push_back(static_cast<char>(offset & 0xff));
+            output.push_back(static_cast<char>(offset >> 8));
+            if (extra >= 15)
+            {
+                writeLength(output, extra - 15);
+            }
+        }
+    };
+
+    /**
+     * A string value as the cache stores it: raw below the threshold or when compression does not pay,
+     * codec output otherwise. Copies share one immutable buffer, so reading it out of a cache under the
+     * lock is a reference count bump and decoding happens afterwards. storedBytes() is the weight to
+     * give LruCache::enableWeigher().
+     */
+    class CompressedValue
+    {
+    public:
+        CompressedValue() = default;
+
+        static CompressedValue encode(const ValueCodec &codec, const std::string &value, size_t threshold)
+        {
+            auto blob = std::make_shared<std::string>();
+            if (value.size() >= threshold)
+            {
+                std::string compressed = codec.compress(value);
+                if (compressed.size() < value.size())
+                {
+                    blob->reserve(compressed.size() + 1);
+                    blob->push_back(COMPRESSED);
+                    blob->append(compressed);
+                    return CompressedValue(std::move(blob));
+                }
+            }
+            blob->reserve(value.size() + 1);
+            blob->push_back(RAW);
+            blob->append(value);
+            return CompressedValue(std::move(blob));
+        }
+        bool decode(const ValueCodec &codec, std::string &value) const
+        {
+            if (!blob_ || blob_->empty())
+            {
+                value.clear();
+                return true;
+            }
+            if ((*blob_)[0] == RAW)
+            {
+                value.assign(blob_->data() + 1, blob_->size() - 1);
+                return true;
+            }
+            return codec.decompress(blob_->data() + 1, blob_->size() - 1, value);
+        }
+        size_t storedBytes() const
+        {
+            return blob_ ? blob_->size() : 0;
+        }
+        bool compressed() const
+        {
+            return blob_ && !blob_->empty() && (*blob_)[0] == COMPRESSED;
+        }
+
+    private:
+        friend struct SnapshotSerializer<CompressedValue>;
+        static constexpr char RAW = 0;
+        static constexpr char COMPRESSED = 1;
+
+        explicit CompressedValue(std::shared_ptr<const std::string> blob)
+            : blob_(std::move(blob))
+        {
+        }
+
+        std::shared_ptr<const std::string> blob_;
+    };
+
+    // snapshots and operation logs keep values compressed
+    template <>
+    struct SnapshotSerializer<CompressedValue>
+    {
+        static void write(std::string &out, const CompressedValue &value)
+        {
+            SnapshotSerializer<std::string>::write(out, value.blob_ ? *value.blob_ : std::string());
+        }
+        static bool read(const char *&cursor, const char *end, CompressedValue &value)
+        {
+            auto blob = std::make_shared<std::string>();
+            if (!SnapshotSerializer<std::string>::read(cursor, end, *blob))
+            {
+                return false;
+            }
+            value = CompressedValue(std::move(blob));
+            return true;
+        }
+    };
+
+    /**
+     * std::string cache on top of any cache of CompressedValue (LruCache, LfuCache, ArcCache, HashLruCaches,
+     * HashLfuCache): values of at least threshold bytes are compressed before the put and decompressed
+     * after the get, both outside the inner cache's lock. The remaining constructor arguments construct
+     * the inner cache; cache() gives access to it, e.g. for a weigher on storedBytes().
+     */
+    template <typename Key, typename Cache = LruCache<Key, CompressedValue>>
+    class CompressingCache : public CachePolicy<Key, std::string>
+    {
+    public:
+        template <typename... Args>
+        CompressingCache(std::shared_ptr<const ValueCodec> codec, size_t threshold, Args &&...args)
+            : codec_(std::move(codec)), threshold_(threshold), cache_(std::forward<Args>(args)...)
+        {
+        }
+        ~CompressingCache() override = default;
+
+        void put(Key key, std::string value) override
+        {
+            cache_.put(key, CompressedValue::encode(*codec_, value, threshold_));
+        }
+        bool get(Key key, std::string &value) override
+        {
+            CompressedValue stored;
+            return cache_.get(key, stored) && stored.decode(*codec_, value);
+        }
+        std::string get(Key key) override
+        {
+            std::string value;
+            get(key, value);
+            return value;
+        }
+        Cache &cache()
+        {
+            return cache_;
+        }
+
+    private:
+        std::shared_ptr<const ValueCodec> codec_;
+        size_t threshold_;
+        Cache cache_;
+    };
+}
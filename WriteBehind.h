@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mwm1cCache
+{
+    /**
+     * Buffers dirty entries of a write-behind cache and pushes them to a user supplied batch sink.
+     * Repeated writes to a dirty key only overwrite the buffered value, so a hot key costs one backend
+     * write per flush instead of one per put. A background thread flushes every interval, or earlier
+     * once batchSize keys are dirty.
+     */
+    template <typename Key, typename Value>
+    class WriteBehindFlusher
+    {
+    public:
+        using Batch = std::vector<std::pair<Key, Value>>;
+        using BatchSink = std::function<void(const Batch &)>;
+
+        WriteBehindFlusher(BatchSink sink, size_t batchSize, std::chrono::milliseconds interval)
+            : sink_(std::move(sink)), batchSize_(batchSize > 0 ? batchSize : 1), interval_(interval), stop_(false)
+        {
+            flushThread_ = std::thread([this]() { flushLoop(); });
+        }
+        ~WriteBehindFlusher()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_one();
+            flushThread_.join();
+            flush();
+        }
+        void markDirty(const Key &key, const Value &value)
+        {
+            bool batchReady = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                dirty_[key] = value;
+                batchReady = dirty_.size() >= batchSize_;
+            }
+            if (batchReady)
+            {
+                cond_.notify_one();
+            }
+        }
+        // synchronously writes the given keys if they are still dirty, used before an entry is evicted
+        void flushKeys(const std::vector<Key> &keys)
+        {
+            std::lock_guard<std::mutex> sinkLock(sinkMutex_);
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto &key : keys)
+                {
+                    auto it = dirty_.find(key);
+                    if (it != dirty_.end())
+                    {
+                        batch.emplace_back(it->first, it->second);
+                        dirty_.erase(it);
+                    }
+                }
+            }
+            if (!batch.empty())
+            {
+                sink_(batch);
+            }
+        }
+        // synchronously writes every dirty entry
+        void flush()
+        {
+            while (flushBatch())
+            {
+            }
+        }
+        size_t dirtyCount()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return dirty_.size();
+        }
+
+    private:
+        void flushLoop()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_)
+            {
+                cond_.wait_for(lock, interval_, [this]() { return stop_ || dirty_.size() >= batchSize_; });
+                if (stop_)
+                {
+                    break;
+                }
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        }
+        /**
+         * Takes at most one batch out of the dirty map and writes it. The sink lock is held from take
+         * to write so that two batches carrying the same key can never reach the sink out of order.
+         */
+        bool flushBatch()
+        {
+            std::lock_guard<std::mutex> sinkLock(sinkMutex_);
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = dirty_.begin();
+                while (it != dirty_.end() && batch.size() < batchSize_)
+                {
+                    batch.emplace_back(it->first, std::move(it->second));
+                    it = dirty_.erase(it);
+                }
+            }
+            if (batch.empty())
+            {
+                return false;
+            }
+            sink_(batch);
+            return true;
+        }
+
+        BatchSink sink_;
+        size_t batchSize_;
+        std::chrono::milliseconds interval_;
+        bool stop_;
+        // lock order: sinkMutex_ before mutex_, the cache lock before mutex_
+        std::mutex sinkMutex_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::unordered_map<Key, Value> dirty_;
+        std::thread flushThread_;
+    };
+}
@@ -5,10 +5,31 @@
 #include <iomanip>
 #include <random>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "CacheExecutor.h"
 #include "CachePolicy.h"
+#include "ConcurrentClockCache.h"
+#include "EpochReclaimer.h"
 #include "LFUCache.h"
 #include "LRUCache.h"
+#include "MaintenanceScheduler.h"
+#include "PolicyCache.h"
+#include "InternedLruCache.h"
+#include "SegCache.h"
+#include "SegmentedLruCache.h"
+#include "SlabAllocator.h"
+#include "TieredCache.h"
+#include "ValueCodec.h"
 #include "ArcCache/ArcCache.h"
 
 class Timer
@@ -28,21 +49,21 @@ private:
 
 void printResults(const std::string &testName, int capacity,
                   const std::vector<int> &get_operations,
-                  const std::vector<int> &hits)
+                  const std::vector<int> &hits,
+                  std::vector<std::string> names = {})
 {
     std::cout << "=== " << testName << " Summary ===" << std::endl;
     std::cout << "Cache Capacity: " << capacity << std::endl;
 
-    std::vector<std::string> names;
-    if (hits.size() == 3)
+    if (names.empty() && hits.size() == 3)
     {
         names = {"LRU", "LFU", "ARC"};
     }
-    else if (hits.size() == 4)
+    else if (names.empty() && hits.size() == 4)
     {
         names = {"LRU", "LFU", "ARC", "LRU-K"};
     }
-    else if (hits.size() == 5)
+    else if (names.empty() && hits.size() == 5)
     {
         names = {"LRU", "LFU", "ARC", "LRU-K", "LFU-Aging"};
     }
@@ -71,10 +92,12 @@ void testHotDataAccess()
     mwm1cCache::LruCache<int, std::string> lru(CAPACITY);
     mwm1cCache::LfuCache<int, std::string> lfu(CAPACITY);
     mwm1cCache::ArcCache<int, std::string> arc(CAPACITY);
+    mwm1cCache::LruCache<int, std::string> midpoint(CAPACITY);
+    midpoint.enableMidpointInsertion();
 
-    std::array<mwm1cCache::CachePolicy<int, std::string> *, 3> caches = {&lru, &lfu, &arc};
-    std::vector<int> hits(3, 0);
-    std::vector<int> get_operations(3, 0);
+    std::array<mwm1cCache::CachePolicy<int, std::string> *, 4> caches = {&lru, &lfu, &arc, &midpoint};
+    std::vector<int> hits(4, 0);
+    std::vector<int> get_operations(4, 0);
 
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -117,7 +140,7 @@ void testHotDataAccess()
         }
     }
 
-    printResults("Host Data Access Test", CAPACITY, get_operations, hits);
+    printResults("Host Data Access Test", CAPACITY, get_operations, hits, {"LRU", "LFU", "ARC", "LRU-Midpoint"});
 }
 
 void testLoopPattern()
@@ -131,10 +154,12 @@ void testLoopPattern()
     mwm1cCache::LruCache<int, std::string> lru(CAPACITY);
     mwm1cCache::LfuCache<int, std::string> lfu(CAPACITY);
     mwm1cCache::ArcCache<int, std::string> arc(CAPACITY);
+    mwm1cCache::LruCache<int, std::string> midpoint(CAPACITY);
+    midpoint.enableMidpointInsertion();
 
-    std::array<mwm1cCache::CachePolicy<int, std::string> *, 3> caches = {&lru, &lfu, &arc};
-    std::vector<int> hits(3, 0);
-    std::vector<int> get_operations(3, 0);
+    std::array<mwm1cCache::CachePolicy<int, std::string> *, 4> caches = {&lru, &lfu, &arc, &midpoint};
+    std::vector<int> hits(4, 0);
+    std::vector<int> get_operations(4, 0);
 
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -183,7 +208,7 @@ void testLoopPattern()
         }
     }
 
-    printResults("Loop Scan Test", CAPACITY, get_operations, hits);
+    printResults("Loop Scan Test", CAPACITY, get_operations, hits, {"LRU", "LFU", "ARC", "LRU-Midpoint"});
 
 }
 
@@ -294,10 +319,1405 @@ void testWorkloadShift()
     printResults("Workload Shift Test", CAPACITY, get_operations, hits);
 }
 
+void testMissStampede()
+{
+    std::cout << "\n=== Test Scenario 4: Miss Stampede ===" << std::endl;
+
+    const int CAPACITY = 64;
+    const int THREADS = 16;
+    const int ROUNDS = 20;
+
+    mwm1cCache::HashLruCaches<int, std::string> naiveCache(CAPACITY, 4);
+    mwm1cCache::HashLruCaches<int, std::string> coalescedCache(CAPACITY, 4);
+    std::atomic<int> naiveBackendCalls(0);
+    std::atomic<int> coalescedBackendCalls(0);
+
+    auto slowBackend = [](std::atomic<int> &calls, int key) {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return "value" + std::to_string(key);
+    };
+
+    // every round, all threads miss on the same fresh key at once
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([&, round]() {
+                std::string value;
+                if (!naiveCache.get(round, value))
+                {
+                    naiveCache.put(round, slowBackend(naiveBackendCalls, round));
+                }
+                coalescedCache.getOrLoad(round, [&](int key) {
+                    return slowBackend(coalescedBackendCalls, key);
+                });
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::cout << "Threads: " << THREADS << ", Missed Keys: " << ROUNDS << std::endl;
+    std::cout << "get/put - Backend Calls Per Miss: " << std::fixed << std::setprecision(2)
+              << static_cast<double>(naiveBackendCalls) / ROUNDS << std::endl;
+    std::cout << "getOrLoad - Backend Calls Per Miss: " << std::fixed << std::setprecision(2)
+              << static_cast<double>(coalescedBackendCalls) / ROUNDS << std::endl;
+
+    // read-through must count a request once in the LRU-K history, so the key enters the main cache on the k-th
+    const int K = 3;
+    mwm1cCache::LruKCache<int, std::string> lruKCache(CAPACITY, CAPACITY, K);
+    mwm1cCache::LoadingCache<int, std::string, mwm1cCache::LruKCache<int, std::string>> lruKLoading(lruKCache);
+    int lruKBackendCalls = 0;
+    int admittedOn = 0;
+    for (int request = 1; request <= K + 1 && admittedOn == 0; ++request)
+    {
+        lruKLoading.getOrLoad(0, [&](int key) {
+            ++lruKBackendCalls;
+            return "value" + std::to_string(key);
+        });
+        // peek only looks at the main cache
+        std::string value;
+        if (lruKCache.peek(0, value))
+        {
+            admittedOn = request;
+        }
+    }
+    std::cout << "LRU-K (k=" << K << ") getOrLoad - Admitted on Request: " << admittedOn << " (expected " << K
+              << "), Backend Calls: " << lruKBackendCalls << std::endl;
+    std::cout << std::endl;
+}
+
+void testAsyncLoading()
+{
+    std::cout << "\n=== Test Scenario 5: Async Loading ===" << std::endl;
+
+    const int CAPACITY = 128;
+    const int REQUESTS = 64;
+    const int BACKEND_LATENCY_MS = 5;
+
+    auto slowBackend = [=](int key) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(BACKEND_LATENCY_MS));
+        return "value" + std::to_string(key);
+    };
+
+    // one event-loop worker serves every request; blocking loads stall it for the whole backend latency
+    mwm1cCache::HashLruCaches<int, std::string> blockingCache(CAPACITY, 4);
+    Timer blockingTimer;
+    for (int key = 0; key < REQUESTS; ++key)
+    {
+        blockingCache.getOrLoad(key, slowBackend);
+    }
+    double blockingBusy = blockingTimer.elapsed();
+
+    mwm1cCache::HashLruCaches<int, std::string> asyncCache(CAPACITY, 4);
+    mwm1cCache::ThreadPoolExecutor executor(8);
+    std::vector<std::shared_future<std::string>> futures;
+    Timer asyncTimer;
+    for (int key = 0; key < REQUESTS; ++key)
+    {
+        futures.push_back(asyncCache.getAsync(key, slowBackend, executor));
+    }
+    double asyncBusy = asyncTimer.elapsed();
+    for (auto &future : futures)
+    {
+        future.wait();
+    }
+    double asyncTotal = asyncTimer.elapsed();
+
+    std::cout << "Requests: " << REQUESTS << ", Backend Latency: " << BACKEND_LATENCY_MS << "ms" << std::endl;
+    std::cout << "getOrLoad - Worker Blocked: " << blockingBusy << "ms" << std::endl;
+    std::cout << "getAsync - Worker Blocked: " << asyncBusy << "ms, All Loads Completed: "
+              << asyncTotal << "ms" << std::endl;
+    std::cout << std::endl;
+}
+
+void testWriteBehind()
+{
+    std::cout << "\n=== Test Scenario 6: Write-Behind Counters ===" << std::endl;
+
+    const int CAPACITY = 64;
+    const int OPERATIONS = 200000;
+    const int HOT_KEYS = 16;
+
+    std::atomic<int> backendWrites(0);
+    std::atomic<int> backendBatches(0);
+    mwm1cCache::HashLruCaches<int, int> cache(CAPACITY, 4);
+    cache.enableWriteBehind([&](const std::vector<std::pair<int, int>> &batch) {
+        backendWrites += batch.size();
+        ++backendBatches;
+    }, 32, std::chrono::milliseconds(10));
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    for (int op = 0; op < OPERATIONS; ++op)
+    {
+        int key = gen() % HOT_KEYS;
+        cache.put(key, cache.get(key) + 1);
+    }
+    cache.flush();
+
+    std::cout << "Counter Updates: " << OPERATIONS << std::endl;
+    std::cout << "Write-Through - Backend Writes: " << OPERATIONS << std::endl;
+    std::cout << "Write-Behind - Backend Writes: " << backendWrites << " in " << backendBatches << " batches" << std::endl;
+    std::cout << std::endl;
+}
+
+double percentile(std::vector<double> latencies, double ratio)
+{
+    if (latencies.empty())
+    {
+        return 0;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[static_cast<size_t>(ratio * (latencies.size() - 1))];
+}
+
+void testRefreshAhead()
+{
+    std::cout << "\n=== Test Scenario 7: Refresh-Ahead on TTL Workload ===" << std::endl;
+
+    const int CAPACITY = 64;
+    const int HOT_KEYS = 32;
+    const auto DURATION = std::chrono::milliseconds(400);
+    const auto EXPIRE_AFTER = std::chrono::milliseconds(40);
+    const auto REFRESH_AFTER = std::chrono::milliseconds(20);
+
+    auto slowBackend = [](const int &key) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        return "value" + std::to_string(key);
+    };
+    auto runWorkload = [&](mwm1cCache::HashLruCaches<int, std::string> &cache) {
+        std::mt19937 gen(42);
+        std::vector<double> latencies;
+        auto end = std::chrono::steady_clock::now() + DURATION;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            int key = gen() % HOT_KEYS;
+            auto start = std::chrono::steady_clock::now();
+            cache.getOrLoad(key, slowBackend);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        return latencies;
+    };
+
+    mwm1cCache::HashLruCaches<int, std::string> ttlCache(CAPACITY, 4);
+    ttlCache.enableExpiry(EXPIRE_AFTER);
+    std::vector<double> ttlLatencies = runWorkload(ttlCache);
+
+    mwm1cCache::HashLruCaches<int, std::string> refreshCache(CAPACITY, 4);
+    // declared after the cache, so it is destroyed first and drains the reloads while the cache is alive
+    mwm1cCache::ThreadPoolExecutor executor(2);
+    refreshCache.enableRefreshAhead(REFRESH_AFTER, EXPIRE_AFTER, slowBackend, executor);
+    std::vector<double> refreshLatencies = runWorkload(refreshCache);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "TTL Only - p50: " << percentile(ttlLatencies, 0.5) << "us, p99: "
+              << percentile(ttlLatencies, 0.99) << "us" << std::endl;
+    std::cout << "Refresh-Ahead - p50: " << percentile(refreshLatencies, 0.5) << "us, p99: "
+              << percentile(refreshLatencies, 0.99) << "us" << std::endl;
+    std::cout << std::endl;
+}
+
+void testSnapshotRestore()
+{
+    std::cout << "\n=== Test Scenario 8: Snapshot Warm Restart ===" << std::endl;
+
+    const int CAPACITY = 200000;
+    const std::string PATH = "lru_cache.snapshot";
+
+    mwm1cCache::LruCache<int, std::string> cache(CAPACITY);
+    for (int key = 0; key < CAPACITY; ++key)
+    {
+        cache.put(key, "value" + std::to_string(key));
+    }
+
+    Timer saveTimer;
+    bool saved = cache.saveSnapshot(PATH);
+    double saveTime = saveTimer.elapsed();
+
+    // rebuilding through put is what a restart without snapshots would cost at best
+    mwm1cCache::LruCache<int, std::string> replayed(CAPACITY);
+    Timer replayTimer;
+    for (int key = 0; key < CAPACITY; ++key)
+    {
+        replayed.put(key, "value" + std::to_string(key));
+    }
+    double replayTime = replayTimer.elapsed();
+
+    mwm1cCache::LruCache<int, std::string> restored(CAPACITY);
+    Timer loadTimer;
+    bool loaded = restored.loadSnapshot(PATH);
+    double loadTime = loadTimer.elapsed();
+    std::remove(PATH.c_str());
+
+    std::string value;
+    std::cout << "Entries: " << CAPACITY << ", Saved: " << saved << ", Loaded: " << loaded
+              << ", Last Key Restored: " << restored.get(CAPACITY - 1, value) << std::endl;
+    std::cout << "Save: " << saveTime << "ms, Load: " << loadTime << "ms, put Replay: " << replayTime << "ms" << std::endl;
+    std::cout << std::endl;
+}
+
+void testBackgroundSnapshot()
+{
+    std::cout << "\n=== Test Scenario 9: Snapshot While Serving ===" << std::endl;
+
+    const int CAPACITY = 400000;
+    // a blocking dump stalls a slice for as long as writing it takes, so few large slices show it best
+    const int SLICES = 2;
+    const std::string PATH = "lfu_cache.snapshot";
+
+    mwm1cCache::HashLfuCache<int, std::string> cache(CAPACITY, SLICES);
+    for (int key = 0; key < CAPACITY; ++key)
+    {
+        cache.put(key, "value" + std::to_string(key));
+    }
+
+    // foreground traffic measured while the main thread takes a snapshot; returns the worst latency in ms
+    auto serveDuring = [&](const std::function<void()> &snapshot) {
+        std::atomic<bool> done(false);
+        std::vector<double> latencies;
+        // reserved up front, a reallocation in the loop would show up as a stall of its own
+        latencies.reserve(8000000);
+        std::thread worker([&]() {
+            std::mt19937 gen(7);
+            std::string value;
+            while (!done)
+            {
+                int key = gen() % CAPACITY;
+                auto start = std::chrono::steady_clock::now();
+                if (gen() % 100 < 20)
+                {
+                    cache.put(key, "value" + std::to_string(key));
+                }
+                else
+                {
+                    cache.get(key, value);
+                }
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        Timer timer;
+        snapshot();
+        double snapshotTime = timer.elapsed();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        done = true;
+        worker.join();
+        size_t stalled = std::count_if(latencies.begin(), latencies.end(), [](double latency) { return latency >= 1000; });
+        std::cout << std::fixed << std::setprecision(2) << "p99: " << percentile(latencies, 0.99)
+                  << "us, p99.9: " << percentile(latencies, 0.999) << "us, max: " << percentile(latencies, 1.0)
+                  << "us, ops over 1ms: " << stalled << ", snapshot took " << snapshotTime << "ms" << std::endl;
+        return percentile(latencies, 1.0) / 1000;
+    };
+
+    std::cout << "Blocking saveSnapshot - ";
+    double blockingStall = serveDuring([&]() { cache.saveSnapshot(PATH); });
+    std::cout << "saveSnapshotInBackground - ";
+    double backgroundStall = serveDuring([&]() {
+        cache.saveSnapshotInBackground(PATH);
+        cache.waitSnapshot();
+    });
+    std::cout << "Longest foreground stall: " << blockingStall << "ms blocking vs " << backgroundStall
+              << "ms in background, " << blockingStall / std::max(backgroundStall, 0.001) << "x shorter" << std::endl;
+    if (std::thread::hardware_concurrency() <= 1)
+    {
+        std::cout << "(single hardware thread: the dump child preempts the worker, hence the extra ops over 1ms)" << std::endl;
+    }
+    for (int i = 0; i < SLICES; ++i)
+    {
+        std::remove(mwm1cCache::BackgroundSnapshot::slicePath(PATH, i).c_str());
+    }
+    std::cout << std::endl;
+}
+
+void testLogRecovery()
+{
+    std::cout << "\n=== Test Scenario 10: Snapshot + Operation Log Recovery ===" << std::endl;
+
+    const int CAPACITY = 400000;
+    const int SLICES = 8;
+    const std::string DIR = "cache_oplog";
+    const std::string PATH = DIR + "/cache";
+    std::filesystem::create_directories(DIR);
+
+    double putTime = 0;
+    {
+        mwm1cCache::HashLruCaches<int, std::string> cache(CAPACITY, SLICES);
+        cache.enableOperationLog(PATH, std::chrono::milliseconds(10));
+        Timer timer;
+        for (int key = 0; key < CAPACITY / 2; ++key)
+        {
+            cache.put(key, "value" + std::to_string(key));
+        }
+        // the snapshot truncates the logs, only the second half has to be replayed
+        cache.saveSnapshot(PATH);
+        for (int key = CAPACITY / 2; key < CAPACITY; ++key)
+        {
+            cache.put(key, "value" + std::to_string(key));
+        }
+        for (int key = 0; key < CAPACITY; key += 10)
+        {
+            cache.remove(key);
+        }
+        putTime = timer.elapsed();
+    }
+
+    mwm1cCache::HashLruCaches<int, std::string> recovered(CAPACITY, SLICES);
+    Timer recoverTimer;
+    recovered.recover(PATH);
+    double recoverTime = recoverTimer.elapsed();
+    std::filesystem::remove_all(DIR);
+
+    int present = 0;
+    std::string value;
+    for (int key = 0; key < CAPACITY; ++key)
+    {
+        present += recovered.get(key, value);
+    }
+    std::cout << "Logged writes: " << putTime << "ms, Recovery: " << recoverTime << "ms" << std::endl;
+    std::cout << "Entries recovered: " << present << " (expected " << CAPACITY - CAPACITY / 10 << ")" << std::endl;
+    std::cout << std::endl;
+}
+
+void testTieredCache()
+{
+    std::cout << "\n=== Test Scenario 11: Working Set 10x Memory, Disk Second Tier ===" << std::endl;
+
+    const int MEMORY_CAPACITY = 5000;
+    const int KEYS = 50000;
+    const int OPERATIONS = 300000;
+    const std::string VALUE(512, 'v');
+
+    // 80% of the accesses go to 20% of the keys, a miss reloads from the backend
+    auto runWorkload = [&](mwm1cCache::CachePolicy<int, std::string> &cache,
+                           const std::function<mwm1cCache::TierStats()> &stats, const std::string &name) {
+        std::mt19937 gen(11);
+        std::array<std::vector<double>, 3> latencies;
+        std::string value;
+        for (int op = 0; op < OPERATIONS; ++op)
+        {
+            int key = gen() % 100 < 80 ? gen() % (KEYS / 5) : KEYS / 5 + gen() % (KEYS - KEYS / 5);
+            mwm1cCache::TierStats before = stats();
+            auto start = std::chrono::steady_clock::now();
+            bool hit = cache.get(key, value);
+            double latency = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            mwm1cCache::TierStats after = stats();
+            latencies[after.memoryHits > before.memoryHits ? 0 : (after.diskHits > before.diskHits ? 1 : 2)].push_back(latency);
+            if (!hit)
+            {
+                cache.put(key, VALUE);
+            }
+        }
+        mwm1cCache::TierStats total = stats();
+        std::cout << name << std::fixed << std::setprecision(2)
+                  << " - Memory Hits: " << 100.0 * total.memoryHits / OPERATIONS << "% (p50 " << percentile(latencies[0], 0.5) << "us)"
+                  << ", Disk Hits: " << 100.0 * total.diskHits / OPERATIONS << "% (p50 " << percentile(latencies[1], 0.5) << "us)"
+                  << ", Misses: " << 100.0 * total.misses / OPERATIONS << "%" << std::endl;
+    };
+
+    // admitting nothing to disk leaves the plain memory cache as the baseline
+    mwm1cCache::TieredCache<int, std::string> memoryOnly(MEMORY_CAPACITY, "tiered_none", 0, 4 << 20,
+                                                         [](const int &, const std::string &) { return false; });
+    runWorkload(memoryOnly, [&]() { return memoryOnly.stats(); }, "LRU Memory Only");
+
+    mwm1cCache::TieredCache<int, std::string> tieredLru(MEMORY_CAPACITY, "tiered_lru", KEYS * 600);
+    runWorkload(tieredLru, [&]() { return tieredLru.stats(); }, "LRU + Disk");
+
+    mwm1cCache::TieredCache<int, std::string, mwm1cCache::ArcCache<int, std::string>> tieredArc(MEMORY_CAPACITY, "tiered_arc", KEYS * 600);
+    runWorkload(tieredArc, [&]() { return tieredArc.stats(); }, "ARC + Disk");
+    std::cout << "Disk Tier: " << tieredArc.diskEntries() << " entries in " << tieredArc.diskBytes() / 1024 << "KB" << std::endl;
+    std::cout << std::endl;
+}
+
+long residentKb()
+{
+    long pages = 0, resident = 0;
+    std::FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (statm && std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    {
+        resident = 0;
+    }
+    if (statm)
+    {
+        std::fclose(statm);
+    }
+    return resident * (::getpagesize() / 1024);
+}
+
+// runs fn in a forked child so every variant starts from the same heap, returns what fn returned
+long runInChild(const std::function<long()> &fn)
+{
+    int fds[2];
+    if (::pipe(fds) != 0)
+    {
+        return -1;
+    }
+    pid_t pid = ::fork();
+    if (pid == 0)
+    {
+        // give back what earlier scenarios freed, so trimming during fn cannot hide its growth
+        ::malloc_trim(0);
+        long result = fn();
+        ssize_t written = ::write(fds[1], &result, sizeof(result));
+        ::_exit(written == sizeof(result) ? 0 : 1);
+    }
+    long result = -1;
+    if (pid > 0 && ::read(fds[0], &result, sizeof(result)) != sizeof(result))
+    {
+        result = -1;
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    ::waitpid(pid, nullptr, 0);
+    return result;
+}
+
+void testSlabChurn()
+{
+    std::cout << "\n=== Test Scenario 12: Value Memory Under Size-Shifting Churn ===" << std::endl;
+
+    const int CAPACITY = 50000;
+    const int KEYS = 200000;
+    const int PUTS_PER_PHASE = 400000;
+    // the value size distribution moves between phases, which is what strands memory in a general heap
+    const std::vector<std::pair<int, int>> PHASES = {{64, 256}, {1024, 4096}, {128, 512}, {2048, 8192}, {256, 1024}};
+    const std::string BYTES(8192, 'x');
+
+    auto churn = [&](auto &cache, auto makeValue) {
+        std::mt19937 gen(5);
+        std::atomic<long> logicalBytes(0);
+        cache.addRemovalListener([&](const int &, const auto &value, mwm1cCache::RemovalCause) { logicalBytes -= value.size(); });
+        for (auto &phase : PHASES)
+        {
+            for (int op = 0; op < PUTS_PER_PHASE; ++op)
+            {
+                int size = phase.first + gen() % (phase.second - phase.first);
+                logicalBytes += size;
+                cache.put(gen() % KEYS, makeValue(size));
+            }
+        }
+        return logicalBytes.load();
+    };
+
+    long stringRss = runInChild([&]() {
+        long before = residentKb();
+        mwm1cCache::LruCache<int, std::string> cache(CAPACITY);
+        long logical = churn(cache, [&](int size) { return BYTES.substr(0, size); });
+        std::cout << "std::string values - Live Value Bytes: " << logical / 1024 << "KB" << std::flush;
+        return residentKb() - before;
+    });
+    std::cout << ", RSS Growth: " << stringRss << "KB" << std::endl;
+
+    long slabRss = runInChild([&]() {
+        long before = residentKb();
+        mwm1cCache::SlabAllocator allocator;
+        mwm1cCache::LruCache<int, mwm1cCache::SlabBuffer> cache(CAPACITY);
+        long logical = churn(cache, [&](int size) { return mwm1cCache::SlabBuffer(allocator, BYTES.data(), size); });
+        mwm1cCache::SlabStats stats = allocator.stats();
+        std::cout << "SlabBuffer values  - Live Value Bytes: " << logical / 1024 << "KB, Slab Mapped: " << stats.mappedBytes / 1024
+                  << "KB (pooled " << stats.pooledBytes / 1024 << "KB, chunks " << stats.chunkBytes / 1024 << "KB)" << std::flush;
+        return residentKb() - before;
+    });
+    std::cout << ", RSS Growth: " << slabRss << "KB" << std::endl;
+
+    // the largest size classes and the switch to dedicated mappings, around half a slab page
+    mwm1cCache::SlabAllocator boundaryAllocator;
+    const std::string LARGE(mwm1cCache::SlabAllocator::PAGE_SIZE, 'y');
+    bool boundaryIntact = true;
+    int boundaryValues = 0;
+    for (size_t size = mwm1cCache::SlabAllocator::PAGE_SIZE * 7 / 16; size <= mwm1cCache::SlabAllocator::PAGE_SIZE / 2 + 64; size += 1000)
+    {
+        mwm1cCache::SlabBuffer value(boundaryAllocator, LARGE.data(), size);
+        boundaryIntact = boundaryIntact && value.size() == size && std::memcmp(value.data(), LARGE.data(), size) == 0;
+        ++boundaryValues;
+    }
+    std::cout << "SlabBuffer values of " << boundaryValues << " sizes around half a page - Round Trip Intact: " << boundaryIntact << std::endl;
+    std::cout << std::endl;
+}
+
+void testSegCache()
+{
+    std::cout << "\n=== Test Scenario 13: Small Objects With TTL, Segment Storage ===" << std::endl;
+
+    const int OBJECTS = 1000000;
+    const int OVERWRITES = 2000000;
+    const auto TTL = std::chrono::minutes(10);
+
+    // bytes of RSS per cached object and put throughput, each variant in its own child
+    auto measure = [&](const std::string &name, auto makeCache) {
+        double putRate = 0;
+        long perObject = runInChild([&]() {
+            long before = residentKb();
+            auto cache = makeCache();
+            std::mt19937 gen(3);
+            Timer timer;
+            for (int key = 0; key < OBJECTS; ++key)
+            {
+                cache->put(key, key);
+            }
+            for (int op = 0; op < OVERWRITES; ++op)
+            {
+                cache->put(gen() % OBJECTS, op);
+            }
+            putRate = (OBJECTS + OVERWRITES) / std::max(timer.elapsed(), 1.0) / 1000.0;
+            std::cout << name << " - Put Throughput: " << std::fixed << std::setprecision(2) << putRate << " Mops/s" << std::flush;
+            return (residentKb() - before) * 1024 / OBJECTS;
+        });
+        std::cout << ", Memory: " << perObject << " bytes/key" << std::endl;
+    };
+
+    measure("LRU (int -> int)", [&]() {
+        auto cache = std::make_unique<mwm1cCache::LruCache<int, int>>(OBJECTS);
+        cache->enableExpiry(TTL);
+        return cache;
+    });
+    measure("SegCache (int -> int)", [&]() {
+        return std::make_unique<mwm1cCache::SegCache<int, int>>(32 << 20, TTL);
+    });
+
+    // one TTL bucket per lifetime, a whole segment goes at once when its TTL runs out
+    mwm1cCache::SegCache<int, int> cache(16 << 20, std::chrono::milliseconds(0));
+    for (int key = 0; key < 100000; ++key)
+    {
+        cache.put(key, key, std::chrono::milliseconds(key % 2 ? 50 : 60000));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int live = 0;
+    int value = 0;
+    for (int key = 0; key < 100000; ++key)
+    {
+        live += cache.get(key, value);
+    }
+    std::cout << "Mixed TTL (50ms / 60s) after 100ms - Readable: " << live << " of 100000" << std::endl;
+
+    // the 50ms bucket's tail has expired with room left; fresh puts must not land in it
+    int fresh = 0;
+    for (int key = 100000; key < 100100; ++key)
+    {
+        cache.put(key, key, std::chrono::milliseconds(50));
+        fresh += cache.get(key, value);
+    }
+    std::cout << "Fresh 50ms puts after the expiry - Readable: " << fresh << " of 100" << std::endl;
+    std::cout << std::endl;
+}
+
+void testCompressedValues()
+{
+    std::cout << "\n=== Test Scenario 14: Compressed JSON Values Under a Byte Budget ===" << std::endl;
+
+    const int KEYS = 10000;
+    const int OPERATIONS = 200000;
+    const size_t BUDGET = 4 << 20;
+    const size_t THRESHOLD = 256;
+
+    // catalogue-like JSON documents of about 4KB
+    const std::vector<std::string> WORDS = {"red", "blue", "cotton", "shirt", "lamp", "desk", "steel", "oak", "mug", "set"};
+    std::mt19937 gen(9);
+    std::vector<std::string> documents;
+    for (int key = 0; key < KEYS; ++key)
+    {
+        std::string document = "{\"id\":" + std::to_string(key) + ",\"items\":[";
+        for (int item = 0; item < 40; ++item)
+        {
+            document += "{\"sku\":\"SKU-" + std::to_string(gen() % 100000) + "\",\"name\":\"" + WORDS[gen() % WORDS.size()] + " " +
+                        WORDS[gen() % WORDS.size()] + "\",\"price\":" + std::to_string(gen() % 10000 / 100.0) +
+                        ",\"inStock\":" + (gen() % 2 ? "true" : "false") + "},";
+        }
+        document.back() = ']';
+        documents.push_back(document + "}");
+    }
+
+    auto codec = std::make_shared<mwm1cCache::LzCodec>();
+    size_t rawBytes = 0;
+    size_t compressedBytes = 0;
+    Timer compressTimer;
+    std::vector<std::string> compressed;
+    for (auto &document : documents)
+    {
+        compressed.push_back(codec->compress(document));
+        rawBytes += document.size();
+        compressedBytes += compressed.back().size();
+    }
+    double compressTime = compressTimer.elapsed();
+    Timer decompressTimer;
+    std::string decoded;
+    bool intact = true;
+    for (int key = 0; key < KEYS; ++key)
+    {
+        intact = codec->decompress(compressed[key].data(), compressed[key].size(), decoded) && decoded == documents[key] && intact;
+    }
+    double decompressTime = decompressTimer.elapsed();
+    std::cout << std::fixed << std::setprecision(2) << "LzCodec - Ratio: " << static_cast<double>(rawBytes) / compressedBytes
+              << "x, Compress: " << rawBytes / 1024.0 / std::max(compressTime, 1.0) << " MB/s, Decompress: "
+              << rawBytes / 1024.0 / std::max(decompressTime, 1.0) << " MB/s, Round Trip Intact: " << intact << std::endl;
+
+    // 80% of the reads go to 20% of the documents, a miss reloads the document
+    auto runWorkload = [&](mwm1cCache::CachePolicy<int, std::string> &cache, const std::function<size_t()> &resident,
+                           const std::string &name) {
+        std::mt19937 gen(13);
+        int hits = 0;
+        std::string value;
+        Timer timer;
+        for (int op = 0; op < OPERATIONS; ++op)
+        {
+            int key = gen() % 100 < 80 ? gen() % (KEYS / 5) : KEYS / 5 + gen() % (KEYS - KEYS / 5);
+            if (cache.get(key, value))
+            {
+                ++hits;
+            }
+            else
+            {
+                cache.put(key, documents[key]);
+            }
+        }
+        double elapsed = timer.elapsed();
+        std::cout << name << " - Entries in " << BUDGET / 1024 << "KB: " << resident() << ", Hit Rate: "
+                  << 100.0 * hits / OPERATIONS << "%, " << elapsed * 1000.0 / OPERATIONS << "us/op" << std::endl;
+    };
+
+    mwm1cCache::LruCache<int, std::string> plain(KEYS);
+    plain.enableWeigher([](const int &, const std::string &value) { return value.size(); }, BUDGET);
+    runWorkload(plain, [&]() { return plain.size(); }, "LRU raw       ");
+
+    mwm1cCache::CompressingCache<int> compressing(codec, THRESHOLD, KEYS);
+    compressing.cache().enableWeigher([](const int &, const mwm1cCache::CompressedValue &value) { return value.storedBytes(); }, BUDGET);
+    runWorkload(compressing, [&]() { return compressing.cache().size(); }, "LRU compressed");
+    std::cout << std::endl;
+}
+
+void testInternedKeys()
+{
+    std::cout << "\n=== Test Scenario 15: Long String Keys, Interned in an Arena ===" << std::endl;
+
+    const int ENTRIES = 500000;
+    const int LOOKUPS = 1000000;
+
+    // URL-like keys of 40 to 100 bytes
+    std::mt19937 gen(21);
+    std::vector<std::string> keys;
+    keys.reserve(ENTRIES);
+    for (int i = 0; i < ENTRIES; ++i)
+    {
+        std::string key = "https://example.com/catalogue/" + std::to_string(i) + "/";
+        size_t length = 40 + gen() % 61;
+        while (key.size() < length)
+        {
+            key.push_back(static_cast<char>('a' + gen() % 26));
+        }
+        keys.push_back(key.substr(0, length));
+    }
+
+    auto measure = [&](const std::string &name, auto makeCache) {
+        long perEntry = runInChild([&]() {
+            long before = residentKb();
+            auto cache = makeCache();
+            for (int i = 0; i < ENTRIES; ++i)
+            {
+                cache->put(keys[i], i);
+            }
+            long growth = residentKb() - before;
+            std::mt19937 gen(4);
+            int value = 0;
+            int hits = 0;
+            Timer timer;
+            for (int op = 0; op < LOOKUPS; ++op)
+            {
+                hits += cache->get(keys[gen() % ENTRIES], value);
+            }
+            std::cout << name << " - Lookups: " << std::fixed << std::setprecision(2)
+                      << LOOKUPS / std::max(timer.elapsed(), 1.0) / 1000.0 << " Mops/s (" << hits << " hits)" << std::flush;
+            return growth * 1024 / ENTRIES;
+        });
+        std::cout << ", Memory: " << perEntry << " bytes/entry" << std::endl;
+    };
+
+    measure("LruCache<std::string, int>        ", [&]() { return std::make_unique<mwm1cCache::LruCache<std::string, int>>(ENTRIES); });
+    measure("InternedLruCache<int>             ", [&]() { return std::make_unique<mwm1cCache::InternedLruCache<int>>(ENTRIES); });
+    std::cout << "Average Key Length: 70 bytes" << std::endl;
+    std::cout << std::endl;
+}
+
+void testNegativeCaching()
+{
+    std::cout << "\n=== Test Scenario 16: Lookups of Keys Missing From the Backend ===" << std::endl;
+
+    const int CAPACITY = 2000;
+    const int KEYS = 10000;
+    const int OPERATIONS = 200000;
+
+    // every third key does not exist in the backend
+    auto runWorkload = [&](bool negativeCaching) {
+        mwm1cCache::HashLruCaches<int, std::string> cache(CAPACITY, 4);
+        if (negativeCaching)
+        {
+            cache.enableNegativeCaching(CAPACITY, std::chrono::seconds(60));
+        }
+        std::atomic<int> backendQueries(0);
+        auto backend = [&](const int &key) -> std::optional<std::string> {
+            ++backendQueries;
+            if (key % 3 == 0)
+            {
+                return std::nullopt;
+            }
+            return "value" + std::to_string(key);
+        };
+        std::mt19937 gen(17);
+        std::array<int, 3> outcomes = {0, 0, 0};
+        std::string value;
+        for (int op = 0; op < OPERATIONS; ++op)
+        {
+            int key = gen() % 100 < 80 ? gen() % (KEYS / 10) : gen() % KEYS;
+            mwm1cCache::LookupResult result = cache.lookup(key, value);
+            ++outcomes[static_cast<int>(result)];
+            if (result == mwm1cCache::LookupResult::Miss)
+            {
+                cache.lookupOrLoad(key, value, backend);
+            }
+        }
+        std::cout << (negativeCaching ? "With Negative Entries   " : "Present Values Only     ") << " - Hits: " << outcomes[0]
+                  << ", Negative Hits: " << outcomes[1] << ", Misses: " << outcomes[2] << ", Backend Queries: " << backendQueries
+                  << std::endl;
+    };
+    runWorkload(false);
+    runWorkload(true);
+    std::cout << std::endl;
+}
+
+void testBloomPrefilter()
+{
+    std::cout << "\n=== Test Scenario 17: Miss-Heavy Lookups Through a Bloom Prefilter ===" << std::endl;
+
+    const int CAPACITY = 100000;
+    const int THREADS = 4;
+    const int OPERATIONS = 500000;
+
+    // keys 0..CAPACITY-1 are cached, about 70% of the lookups go to keys that never were
+    auto runWorkload = [&](size_t countersPerKey) {
+        mwm1cCache::HashLfuCache<int, int> cache(CAPACITY, 8);
+        if (countersPerKey > 0)
+        {
+            cache.enableBloomFilter(countersPerKey);
+        }
+        for (int key = 0; key < CAPACITY; ++key)
+        {
+            cache.put(key, key);
+        }
+        std::atomic<int> hits(0);
+        Timer timer;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                std::mt19937 gen(t + 1);
+                int localHits = 0;
+                int value = 0;
+                for (int op = 0; op < OPERATIONS; ++op)
+                {
+                    int key = gen() % 100 < 70 ? CAPACITY + static_cast<int>(gen() % 10000000) : static_cast<int>(gen() % CAPACITY);
+                    localHits += cache.get(key, value);
+                }
+                hits += localHits;
+            });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+
+        int falsePositives = 0;
+        const int PROBES = 100000;
+        for (int key = 0; key < PROBES; ++key)
+        {
+            falsePositives += cache.mayContain(-1 - key);
+        }
+        std::cout << (countersPerKey == 0 ? std::string("No Filter            ") : "Filter, " + std::to_string(countersPerKey) + " Counters/Key")
+                  << " - Throughput: " << std::fixed << std::setprecision(2) << THREADS * OPERATIONS / elapsed / 1000 << " Mops/s"
+                  << ", False Positive Rate: " << 100.0 * falsePositives / PROBES << "%, Hits: " << hits << std::endl;
+    };
+    runWorkload(0);
+    runWorkload(4);
+    runWorkload(8);
+    runWorkload(16);
+    std::cout << std::endl;
+}
+
+void testBulkInvalidation()
+{
+    std::cout << "\n=== Test Scenario 18: Dropping a Tenant's Entries ===" << std::endl;
+
+    const int TENANTS = 4;
+    const int KEYS_PER_TENANT = 50000;
+
+    // a reader keeps hitting another tenant's keys while one tenant is dropped
+    auto runInvalidation = [&](const std::string &name, std::function<size_t(mwm1cCache::HashLruCaches<std::string, int> &)> invalidate) {
+        mwm1cCache::HashLruCaches<std::string, int> cache(2 * TENANTS * KEYS_PER_TENANT, 4);
+        for (int tenant = 0; tenant < TENANTS; ++tenant)
+        {
+            for (int i = 0; i < KEYS_PER_TENANT; ++i)
+            {
+                std::string tenantName = "tenant" + std::to_string(tenant);
+                cache.put(tenantName + "/" + std::to_string(i), i, {tenantName});
+            }
+        }
+        std::atomic<bool> stop(false);
+        std::vector<double> latencies;
+        std::thread reader([&]() {
+            std::mt19937 gen(18);
+            int value = 0;
+            while (!stop)
+            {
+                std::string key = "tenant1/" + std::to_string(gen() % KEYS_PER_TENANT);
+                auto start = std::chrono::steady_clock::now();
+                cache.get(key, value);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Timer timer;
+        size_t removed = invalidate(cache);
+        double elapsed = timer.elapsed();
+        stop = true;
+        reader.join();
+        int survivor = 0;
+        bool stale = cache.get("tenant0/7", survivor);
+        std::cout << name << " - Removed: " << removed << " in " << elapsed << "ms, Stale Entry Left: " << (stale ? "yes" : "no")
+                  << ", Reader p99: " << percentile(latencies, 0.99) << "us, max: " << percentile(latencies, 1.0) << "us" << std::endl;
+    };
+    runInvalidation("Remove Key by Key", [&](mwm1cCache::HashLruCaches<std::string, int> &cache) {
+        for (int i = 0; i < KEYS_PER_TENANT; ++i)
+        {
+            cache.remove("tenant0/" + std::to_string(i));
+        }
+        return static_cast<size_t>(KEYS_PER_TENANT);
+    });
+    runInvalidation("invalidateTag    ", [](mwm1cCache::HashLruCaches<std::string, int> &cache) {
+        return cache.invalidateTag("tenant0");
+    });
+    runInvalidation("invalidatePrefix ", [](mwm1cCache::HashLruCaches<std::string, int> &cache) {
+        return cache.invalidatePrefix("tenant0/");
+    });
+    std::cout << std::endl;
+}
+
+void testParallelScan()
+{
+    std::cout << "\n=== Test Scenario 19: Scanning a Cache Under Live Traffic ===" << std::endl;
+
+    const int CAPACITY = 400000;
+    const int SLICES = 8;
+
+    // foreground gets/puts are timed while the contents are summed by 0, 1 or 4 scanning threads
+    auto runScan = [&](int scanThreads) {
+        mwm1cCache::HashLruCaches<int, int> cache(CAPACITY, SLICES);
+        for (int key = 0; key < CAPACITY; ++key)
+        {
+            cache.put(key, 1);
+        }
+        std::atomic<bool> scanning(scanThreads > 0);
+        std::vector<double> latencies;
+        std::thread foreground([&]() {
+            std::mt19937 gen(19);
+            int value = 0;
+            for (int op = 0; op < 200000 || scanning; ++op)
+            {
+                int key = gen() % CAPACITY;
+                auto start = std::chrono::steady_clock::now();
+                if (op % 10 == 0)
+                {
+                    cache.put(key, 1);
+                }
+                else
+                {
+                    cache.get(key, value);
+                }
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+        });
+        std::string result = "Foreground Only -";
+        if (scanThreads > 0)
+        {
+            std::atomic<long> sum(0);
+            Timer timer;
+            size_t visited = cache.scan([&](const int &, const int &value) { sum += value; }, scanThreads);
+            double elapsed = std::max(timer.elapsed(), 1.0);
+            scanning = false;
+            result = "Scan, " + std::to_string(scanThreads) + " Thread(s)   - Visited: " + std::to_string(visited) + ", " +
+                     std::to_string(static_cast<long>(visited / elapsed)) + "K entries/s,";
+        }
+        foreground.join();
+        std::cout << result << " Foreground p99: " << percentile(latencies, 0.99) << "us, max: " << percentile(latencies, 1.0) << "us"
+                  << std::endl;
+    };
+    runScan(0);
+    runScan(1);
+    runScan(4);
+    std::cout << std::endl;
+}
+
+void testStaticDispatch()
+{
+    std::cout << "\n=== Test Scenario 20: Virtual vs Static Dispatch ===" << std::endl;
+
+    const int CAPACITY = 10000;
+    const int OPERATIONS = 2000000;
+
+    std::vector<int> keys(OPERATIONS);
+    std::mt19937 gen(20);
+    for (int &key : keys)
+    {
+        key = gen() % 100 < 80 ? gen() % CAPACITY : gen() % (CAPACITY * 4);
+    }
+    // one put per miss, the same key sequence for every cache
+    auto run = [&](const std::string &name, auto &cache) {
+        int hits = 0;
+        int value = 0;
+        Timer timer;
+        for (int key : keys)
+        {
+            if (cache.get(key, value))
+            {
+                ++hits;
+            }
+            else
+            {
+                cache.put(key, key);
+            }
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+        std::cout << name << " - Throughput: " << std::fixed << std::setprecision(2) << OPERATIONS / elapsed / 1000
+                  << " Mops/s, Hits: " << hits << std::endl;
+    };
+    mwm1cCache::LruCache<int, int> lru(CAPACITY);
+    mwm1cCache::CachePolicy<int, int> &virtualLru = lru;
+    run("LruCache through CachePolicy&       ", virtualLru);
+    mwm1cCache::Cache<int, int> composed(CAPACITY);
+    run("Cache<int, int>, inlined            ", composed);
+    mwm1cCache::CachePolicyAdapter<mwm1cCache::Cache<int, int>> adapter(CAPACITY);
+    mwm1cCache::CachePolicy<int, int> &virtualComposed = adapter;
+    run("Cache<int, int> through CachePolicy&", virtualComposed);
+    std::cout << std::endl;
+}
+
+void testLockingStrategies()
+{
+    std::cout << "\n=== Test Scenario 21: Locking Strategies ===" << std::endl;
+
+    const int CAPACITY = 10000;
+    const int OPERATIONS = 400000;
+
+    // 90% reads over a warm cache; peek reads skip the recency update and take shared locks where possible
+    auto run = [&](const std::string &name, auto makeCache, int threads, bool peek) {
+        auto cache = makeCache();
+        for (int key = 0; key < CAPACITY; ++key)
+        {
+            cache->put(key, key);
+        }
+        Timer timer;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                std::mt19937 gen(t + 21);
+                int value = 0;
+                for (int op = 0; op < OPERATIONS / threads; ++op)
+                {
+                    int key = gen() % CAPACITY;
+                    if (op % 10 == 0)
+                    {
+                        cache->put(key, key);
+                    }
+                    else if (peek)
+                    {
+                        cache->peek(key, value);
+                    }
+                    else
+                    {
+                        cache->get(key, value);
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+        std::cout << threads << " Thread(s), " << name << " - Throughput: " << std::fixed << std::setprecision(2)
+                  << OPERATIONS / elapsed / 1000 << " Mops/s" << std::endl;
+    };
+    auto mutexCache = [&]() { return std::make_unique<mwm1cCache::LruCache<int, int>>(CAPACITY); };
+    auto nullCache = [&]() { return std::make_unique<mwm1cCache::LruCache<int, int, mwm1cCache::NullMutex>>(CAPACITY); };
+    auto spinCache = [&]() { return std::make_unique<mwm1cCache::LruCache<int, int, mwm1cCache::SpinMutex>>(CAPACITY); };
+    auto sharedCache = [&]() { return std::make_unique<mwm1cCache::LruCache<int, int, std::shared_mutex>>(CAPACITY); };
+    run("NullMutex, get         ", nullCache, 1, false);
+    for (int threads : {1, 4})
+    {
+        run("std::mutex, get        ", mutexCache, threads, false);
+        run("SpinMutex, get         ", spinCache, threads, false);
+        run("std::shared_mutex, get ", sharedCache, threads, false);
+        run("std::shared_mutex, peek", sharedCache, threads, true);
+    }
+    std::cout << std::endl;
+}
+
+void testConcurrentReads()
+{
+    std::cout << "\n=== Test Scenario 22: Read-Mostly Scaling ===" << std::endl;
+
+    const int CAPACITY = 50000;
+    const int OPERATIONS = 800000;
+
+    // 95% gets over a working set that mostly fits, misses are filled by a put
+    auto run = [&](const std::string &name, auto &cache, int threads) {
+        for (int key = 0; key < CAPACITY; ++key)
+        {
+            cache.put(key, key);
+        }
+        std::atomic<int> hits(0);
+        Timer timer;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                std::mt19937 gen(t + 22);
+                int localHits = 0;
+                int value = 0;
+                for (int op = 0; op < OPERATIONS / threads; ++op)
+                {
+                    int key = gen() % (CAPACITY + CAPACITY / 10);
+                    if (op % 20 == 0)
+                    {
+                        cache.put(key, key);
+                    }
+                    else if (cache.get(key, value))
+                    {
+                        ++localHits;
+                    }
+                    else
+                    {
+                        cache.put(key, key);
+                    }
+                }
+                hits += localHits;
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+        std::cout << threads << " Thread(s), " << name << " - Throughput: " << std::fixed << std::setprecision(2)
+                  << OPERATIONS / elapsed / 1000 << " Mops/s, Hit Rate: " << 100.0 * hits / (OPERATIONS * 0.95) << "%" << std::endl;
+    };
+    for (int threads : {1, 2, 4, 8})
+    {
+        mwm1cCache::HashLruCaches<int, int> sharded(CAPACITY, 8);
+        run("HashLruCaches, 8 Slices", sharded, threads);
+        mwm1cCache::ConcurrentClockCache<int, int> clock(CAPACITY);
+        run("ConcurrentClockCache   ", clock, threads);
+    }
+    std::cout << "(threads beyond " << std::thread::hardware_concurrency() << " hardware threads cannot scale)" << std::endl;
+    std::cout << std::endl;
+}
+
+void testEpochReclamation()
+{
+    std::cout << "\n=== Test Scenario 23: Epoch Reclamation vs shared_ptr Access ===" << std::endl;
+
+    const int SLOTS = 4096;
+    const int READS = 400000;
+
+    struct Item
+    {
+        long payload;
+    };
+    // readers sum random slots while one writer keeps replacing them, freeing the old items safely
+    auto run = [&](const std::string &name, int readers, auto read, auto replace) {
+        std::atomic<bool> stop(false);
+        std::atomic<long> replaced(0);
+        std::thread writer([&]() {
+            std::mt19937 gen(23);
+            while (!stop)
+            {
+                replace(gen() % SLOTS, static_cast<long>(gen()));
+                ++replaced;
+            }
+        });
+        Timer timer;
+        std::vector<std::thread> workers;
+        std::atomic<long> checksum(0);
+        for (int t = 0; t < readers; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                std::mt19937 gen(t + 230);
+                long sum = 0;
+                for (int op = 0; op < READS / readers; ++op)
+                {
+                    sum += read(gen() % SLOTS);
+                }
+                checksum += sum;
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+        stop = true;
+        writer.join();
+        std::cout << readers << " Reader(s), " << name << " - Reads: " << std::fixed << std::setprecision(2) << READS / elapsed / 1000
+                  << " Mops/s, Replacements: " << replaced << std::endl;
+    };
+    for (int readers : {1, 4})
+    {
+        std::vector<std::shared_ptr<Item>> shared(SLOTS);
+        for (auto &slot : shared)
+        {
+            slot = std::make_shared<Item>(Item{0});
+        }
+        run("std::atomic_load(shared_ptr)", readers,
+            [&](int slot) { return std::atomic_load(&shared[slot])->payload; },
+            [&](int slot, long payload) { std::atomic_store(&shared[slot], std::make_shared<Item>(Item{payload})); });
+
+        std::vector<std::atomic<Item *>> raw(SLOTS);
+        for (auto &slot : raw)
+        {
+            slot.store(new Item{0});
+        }
+        run("EpochGuard + retire        ", readers,
+            [&](int slot) {
+                mwm1cCache::EpochGuard guard;
+                return raw[slot].load(std::memory_order_acquire)->payload;
+            },
+            [&](int slot, long payload) {
+                Item *old = raw[slot].exchange(new Item{payload}, std::memory_order_acq_rel);
+                mwm1cCache::EpochReclaimer::shared().retire(old);
+            });
+        for (auto &slot : raw)
+        {
+            delete slot.load();
+        }
+    }
+    std::cout << std::endl;
+}
+
+void testPromotionThrottle()
+{
+    std::cout << "\n=== Test Scenario 24: Throttled Promotion of Hot Keys ===" << std::endl;
+
+    const int CAPACITY = 2000;
+    const int KEYS = 20000;
+    const int OPERATIONS = 400000;
+    const int THREADS = 4;
+
+    // skewed reads: 90% of the lookups go to 1000 hot keys, misses are filled by a put
+    auto run = [&](const std::string &name, auto &cache) {
+        std::atomic<int> hits(0);
+        Timer timer;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                std::mt19937 gen(t + 24);
+                int localHits = 0;
+                int value = 0;
+                for (int op = 0; op < OPERATIONS / THREADS; ++op)
+                {
+                    int key = gen() % 100 < 90 ? gen() % (CAPACITY / 2) : gen() % KEYS;
+                    if (cache.get(key, value))
+                    {
+                        ++localHits;
+                    }
+                    else
+                    {
+                        cache.put(key, key);
+                    }
+                }
+                hits += localHits;
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+        std::cout << name << " - Throughput: " << std::fixed << std::setprecision(2) << OPERATIONS / elapsed / 1000
+                  << " Mops/s, Hit Rate: " << 100.0 * hits / OPERATIONS << "%" << std::endl;
+    };
+    mwm1cCache::LruCache<int, int> always(CAPACITY);
+    run("std::mutex, Promote on Every Hit        ", always);
+    mwm1cCache::LruCache<int, int> throttled(CAPACITY);
+    throttled.enablePromotionThrottle(std::chrono::milliseconds(10));
+    run("std::mutex, Promote Once per 10ms       ", throttled);
+    mwm1cCache::LruCache<int, int, std::shared_mutex> sharedAlways(CAPACITY);
+    run("std::shared_mutex, Promote on Every Hit ", sharedAlways);
+    mwm1cCache::LruCache<int, int, std::shared_mutex> sharedThrottled(CAPACITY);
+    sharedThrottled.enablePromotionThrottle(std::chrono::milliseconds(10));
+    run("std::shared_mutex, Promote Once per 10ms", sharedThrottled);
+    std::cout << std::endl;
+}
+
+void testSegmentedLru()
+{
+    std::cout << "\n=== Test Scenario 25: HOT/WARM/COLD Segmented LRU ===" << std::endl;
+
+    const int CAPACITY = 5000;
+    const int KEYS = 50000;
+    const int OPERATIONS = 400000;
+
+    // 80% of the lookups on a hot set that fits, the rest scattered; misses are filled by a put
+    auto run = [&](const std::string &name, auto &cache, int threads) {
+        std::atomic<int> hits(0);
+        Timer timer;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                std::mt19937 gen(t + 25);
+                int localHits = 0;
+                int value = 0;
+                for (int op = 0; op < OPERATIONS / threads; ++op)
+                {
+                    int key = gen() % 100 < 80 ? gen() % (CAPACITY / 2) : gen() % KEYS;
+                    if (cache.get(key, value))
+                    {
+                        ++localHits;
+                    }
+                    else
+                    {
+                        cache.put(key, key);
+                    }
+                }
+                hits += localHits;
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        double elapsed = std::max(timer.elapsed(), 1.0);
+        std::cout << threads << " Thread(s), " << name << " - Throughput: " << std::fixed << std::setprecision(2)
+                  << OPERATIONS / elapsed / 1000 << " Mops/s, Hit Rate: " << 100.0 * hits / OPERATIONS << "%" << std::endl;
+    };
+    for (int threads : {1, 2, 4, 8})
+    {
+        mwm1cCache::LruCache<int, int> lru(CAPACITY);
+        run("LruCache         ", lru, threads);
+        mwm1cCache::SegmentedLruCache<int, int> segmented(CAPACITY);
+        run("SegmentedLruCache", segmented, threads);
+    }
+    std::cout << std::endl;
+}
+
+void testBackgroundMaintenance()
+{
+    std::cout << "\n=== Test Scenario 26: Housekeeping Inline vs on a Maintenance Thread ===" << std::endl;
+
+    auto report = [](const std::string &name, std::vector<double> &latencies, double elapsed) {
+        std::cout << name << " - p50: " << std::fixed << std::setprecision(2) << percentile(latencies, 0.5)
+                  << "us, p99: " << percentile(latencies, 0.99) << "us, p99.9: " << percentile(latencies, 0.999)
+                  << "us, max: " << percentile(latencies, 1.0) << "us, total: " << elapsed << "ms" << std::endl;
+    };
+
+    // write-behind LRU over a backend that takes 100us per call: every evicted dirty key is written back
+    const int LRU_CAPACITY = 2000;
+    const int LRU_OPERATIONS = 30000;
+    auto runLru = [&](const std::string &name, mwm1cCache::MaintenanceScheduler *scheduler) {
+        mwm1cCache::LruCache<int, int> cache(LRU_CAPACITY);
+        cache.enableWriteBehind([](const std::vector<std::pair<int, int>> &) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }, LRU_CAPACITY * 10, std::chrono::seconds(10));
+        if (scheduler)
+        {
+            cache.enableMaintenance(*scheduler);
+        }
+        std::mt19937 gen(26);
+        std::vector<double> latencies;
+        latencies.reserve(LRU_OPERATIONS);
+        Timer timer;
+        for (int op = 0; op < LRU_OPERATIONS; ++op)
+        {
+            int key = gen() % (LRU_CAPACITY * 10);
+            auto start = std::chrono::steady_clock::now();
+            cache.put(key, op);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        report(name, latencies, timer.elapsed());
+        cache.disableMaintenance();
+    };
+
+    // LFU whose average count crosses maxAvgNum: inline aging walks the whole cache, and keeps doing so
+    // on every access afterwards because it never lowers the running total; the task ages in chunks
+    const int LFU_CAPACITY = 2000;
+    const int LFU_OPERATIONS = 28000;
+    auto runLfu = [&](const std::string &name, mwm1cCache::MaintenanceScheduler *scheduler) {
+        mwm1cCache::LfuCache<int, int> cache(LFU_CAPACITY, 10);
+        if (scheduler)
+        {
+            cache.enableMaintenance(*scheduler);
+        }
+        std::mt19937 gen(26);
+        std::vector<double> latencies;
+        latencies.reserve(LFU_OPERATIONS);
+        int value = 0;
+        Timer timer;
+        for (int op = 0; op < LFU_OPERATIONS; ++op)
+        {
+            int key = gen() % 100 < 80 ? gen() % (LFU_CAPACITY / 2) : gen() % (LFU_CAPACITY * 5);
+            auto start = std::chrono::steady_clock::now();
+            if (!cache.get(key, value))
+            {
+                cache.put(key, key);
+            }
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        report(name, latencies, timer.elapsed());
+        cache.disableMaintenance();
+    };
+
+    mwm1cCache::MaintenanceScheduler scheduler(std::chrono::milliseconds(5));
+    std::cout << "LruCache put, dirty evictions written back:" << std::endl;
+    runLru("  Inline Eviction         ", nullptr);
+    runLru("  Evicted Ahead (90%-95%) ", &scheduler);
+    std::cout << "LfuCache get/put, maxAvgNum 10:" << std::endl;
+    runLfu("  Inline Aging            ", nullptr);
+    runLfu("  Chunked Background Aging", &scheduler);
+    std::cout << "(single hardware thread here: the maintenance thread competes with the foreground for the core)" << std::endl;
+    std::cout << std::endl;
+}
+
 int main()
 {
     testHotDataAccess();
     testLoopPattern();
     testWorkloadShift();
+    testMissStampede();
+    testAsyncLoading();
+    testWriteBehind();
+    testRefreshAhead();
+    testSnapshotRestore();
+    testBackgroundSnapshot();
+    testLogRecovery();
+    testTieredCache();
+    testSlabChurn();
+    testSegCache();
+    testCompressedValues();
+    testInternedKeys();
+    testNegativeCaching();
+    testBloomPrefilter();
+    testBulkInvalidation();
+    testParallelScan();
+    testStaticDispatch();
+    testLockingStrategies();
+    testConcurrentReads();
+    testEpochReclamation();
+    testPromotionThrottle();
+    testSegmentedLru();
+    testBackgroundMaintenance();
     return 0;
 }